@@ -0,0 +1,377 @@
+// runs the sim over a matrix of scenarios & reports per-tick timings of each phase as JSON
+// usage: bench [-s seed] [-t ticks] [-f filter] [-o out.json] [-j threads] [-r]
+// -f only runs the scenarios whose name contains filter
+// -r also renders each tick offscreen (needs the benchrender build, which links SDL)
+#include <stdbool.h>
+#include <time.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+
+#ifdef BENCH_RENDER
+#include "SDL.h"
+#include "SDL_image.h"
+#include "render.h"
+#endif
+
+typedef struct {
+  char* name;
+  int map_w;
+  int map_h;
+  int num_beasts;
+  int num_turrets; // in addition to the starting fortress
+  int density_pct;
+} Scenario;
+
+Scenario scenarios[] = {
+  {"default", 128, 128, 25, 0, 4},
+  {"turrets-128", 128, 128, 100, 50, 4},
+  {"beasts-128", 128, 128, 500, 50, 4},
+  {"dense-128", 128, 128, 100, 50, 20},
+  {"map-256", 256, 256, 200, 100, 4},
+  {"map-512", 512, 512, 500, 200, 4},
+  {"turrets-512", 512, 512, 500, 1000, 4},
+  {"map-1024", 1024, 1024, 1000, 300, 4},
+  {"dense-1024", 1024, 1024, 1000, 300, 20},
+  {"map-2048", 2048, 2048, 2000, 500, 4},
+  {"map-4096", 4096, 4096, 4000, 500, 4}
+};
+int num_scenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+
+// timed phases, in the order they run each tick
+// (the first NUM_STEP_PHASES are the sim's step_phases)
+#define PHASE_STEP NUM_STEP_PHASES // the sum of the step phases
+#define PHASE_RENDER_TERRAIN (PHASE_STEP + 1)
+#define PHASE_RENDER_ENTITIES (PHASE_STEP + 2)
+#define PHASE_RENDER_FOG (PHASE_STEP + 3)
+#define PHASE_RENDER_HUD (PHASE_STEP + 4)
+#define PHASE_RENDER_PRESENT (PHASE_STEP + 5)
+#define PHASE_RENDER (PHASE_STEP + 6) // the sum of the render phases
+#define NUM_PHASES (PHASE_STEP + 7)
+
+// the step phases' names are filled in from step_phases
+char* phase_names[NUM_PHASES] = {
+  [PHASE_STEP] = "step",
+  [PHASE_RENDER_TERRAIN] = "render_terrain",
+  [PHASE_RENDER_ENTITIES] = "render_entities",
+  [PHASE_RENDER_FOG] = "render_fog",
+  [PHASE_RENDER_HUD] = "render_hud",
+  [PHASE_RENDER_PRESENT] = "render_present",
+  [PHASE_RENDER] = "render"
+};
+
+// each tick's time per phase, filled in by time_phase() as step_with_hook() runs
+double* samples[NUM_PHASES];
+int cur_tick;
+double phase_start;
+
+uint64_t seed = 1;
+int num_ticks = 600;
+char* filter = NULL;
+char* out_path = NULL;
+bool is_rendering = false;
+
+// one arena, big enough for the largest scenario, that's reset between scenarios
+Arena arena;
+
+#ifdef BENCH_RENDER
+SDL_Window* window;
+SDL_Renderer* renderer;
+SDL_Texture* sprites;
+Image ui_bar_img;
+#endif
+
+void set_scenario(Scenario* sc);
+void run_scenario(Scenario* sc, FILE* out, bool is_first);
+void time_phase(Game* game, int phase);
+void add_turrets(Game* game, int num_turrets);
+void write_stats(FILE* out, char* name, double samples[], bool is_last);
+int compare_doubles(const void* a, const void* b);
+double now_ms();
+void usage();
+void init_rendering();
+
+int main(int num_args, char* args[]) {
+  for (int i = 1; i < num_args; ++i) {
+    char* flag = args[i];
+    if (!strcmp(flag, "-r")) {
+      is_rendering = true;
+      continue;
+    }
+
+    if (i + 1 >= num_args)
+      usage();
+
+    char* val = args[++i];
+    if (!strcmp(flag, "-s"))
+      seed = strtoull(val, NULL, 10);
+    else if (!strcmp(flag, "-t"))
+      num_ticks = atoi(val);
+    else if (!strcmp(flag, "-f"))
+      filter = val;
+    else if (!strcmp(flag, "-o"))
+      out_path = val;
+    else if (!strcmp(flag, "-j"))
+      num_threads = atoi(val);
+    else
+      usage();
+  }
+
+  if (num_ticks <= 0 || num_threads < 0)
+    usage();
+
+#ifdef BENCH_RENDER
+  if (is_rendering)
+    init_rendering();
+#else
+  if (is_rendering) {
+    printf("this build can't render, use `make benchrender`\n");
+    exit(-1);
+  }
+#endif
+
+  for (int i = 0; i < NUM_STEP_PHASES; ++i)
+    phase_names[i] = step_phases[i].name;
+
+  size_t max_bytes = 0;
+  for (int i = 0; i < num_scenarios; ++i) {
+    if (filter && !strstr(scenarios[i].name, filter))
+      continue;
+
+    set_scenario(&scenarios[i]);
+    Game sizing = {0};
+    calc_level_sizes(&sizing);
+    size_t num_bytes = calc_level_bytes(&sizing);
+    if (num_bytes > max_bytes)
+      max_bytes = num_bytes;
+  }
+  arena_init(&arena, max_bytes);
+
+  FILE* out = stdout;
+  if (out_path) {
+    out = fopen(out_path, "w");
+    if (!out) {
+      printf("opening %s failed\n", out_path);
+      exit(-1);
+    }
+  }
+
+  fprintf(out, "{\n  \"seed\": %llu,\n  \"ticks\": %d,\n  \"tick_ms\": %.4f,\n  \"threads\": %d,\n  \"rendering\": %s,\n  \"scenarios\": [",
+    (unsigned long long)seed, num_ticks, tick_dt * 1000.0, num_threads, is_rendering ? "true" : "false");
+
+  bool is_first = true;
+  for (int i = 0; i < num_scenarios; ++i) {
+    if (filter && !strstr(scenarios[i].name, filter))
+      continue;
+
+    run_scenario(&scenarios[i], out, is_first);
+    is_first = false;
+  }
+  fprintf(out, "\n  ]\n}\n");
+
+  if (out != stdout)
+    fclose(out);
+  arena_free(&arena);
+
+#ifdef BENCH_RENDER
+  if (is_rendering) {
+    SDL_DestroyTexture(sprites);
+    SDL_DestroyTexture(ui_bar_img.tex);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+  }
+#endif
+  return 0;
+}
+
+// sets up the sim's settings for the scenario
+void set_scenario(Scenario* sc) {
+  num_blocks_w = sc->map_w;
+  num_blocks_h = sc->map_h;
+  block_density_pct = sc->density_pct;
+  num_starting_beasts = sc->num_beasts;
+  max_beasts = sc->num_beasts > 500 ? sc->num_beasts : 500;
+  max_turrets = sc->num_turrets + 1 > 500 ? sc->num_turrets + 1 : 500;
+}
+
+void run_scenario(Scenario* sc, FILE* out, bool is_first) {
+  set_scenario(sc);
+  arena_reset(&arena);
+  Game game = {.seed = seed};
+  calc_level_sizes(&game);
+  alloc_level(&game, &arena);
+
+  fprintf(stderr, "%s: %dx%d, %d beasts, %d turrets, %d%% blocks\n",
+    sc->name, sc->map_w, sc->map_h, sc->num_beasts, sc->num_turrets, sc->density_pct);
+
+  double load_start = now_ms();
+  load(&game);
+  add_turrets(&game, sc->num_turrets);
+  double load_ms = now_ms() - load_start;
+
+#ifdef BENCH_RENDER
+  int num_chunks = game.num_chunks_w * game.num_chunks_h;
+  SDL_Texture** chunks = NULL;
+  SDL_Texture* fog = NULL;
+  if (is_rendering) {
+    chunks = calloc(num_chunks, sizeof(SDL_Texture*));
+    fog = create_fog_tex(renderer, &game);
+    game.explored_dirty = (TileRect){.x1 = 0, .y1 = 0, .x2 = game.num_blocks_w - 1, .y2 = game.num_blocks_h - 1};
+    vp.x = clamp(to_x(&game, game.start_pos) * block_w - vp.w / 2, 0, game.num_blocks_w * block_w);
+    vp.y = clamp(to_y(&game, game.start_pos) * block_h - vp.h / 2, 0, game.num_blocks_h * block_h);
+  }
+#endif
+
+  for (int i = 0; i < NUM_PHASES; ++i)
+    samples[i] = calloc(num_ticks, sizeof(double));
+
+  for (int tick = 0; tick < num_ticks; ++tick) {
+    cur_tick = tick;
+    double t0 = now_ms();
+    phase_start = t0;
+    step_with_hook(&game, tick_dt, time_phase);
+    samples[PHASE_STEP][tick] = now_ms() - t0;
+
+#ifdef BENCH_RENDER
+    if (is_rendering) {
+      TileRect vis = calc_visible_tiles(&game);
+      double r0 = now_ms();
+      if (SDL_SetRenderDrawColor(renderer, 44, 34, 30, 255) < 0)
+        error("setting bg color");
+      if (SDL_RenderClear(renderer) < 0)
+        error("clearing renderer");
+      render_terrain(renderer, sprites, chunks, &game, &vis);
+      double r1 = now_ms();
+      render_entities(renderer, sprites, &game, &vis, 1.0);
+      double r2 = now_ms();
+      render_fog(renderer, fog, &game, &vis);
+      double r3 = now_ms();
+      step_ms = samples[PHASE_STEP][tick]; // one step per frame here, so it's already per tick
+      render_hud(renderer, &ui_bar_img, &game);
+      double r4 = now_ms();
+      SDL_RenderPresent(renderer);
+      double r5 = now_ms();
+
+      samples[PHASE_RENDER_TERRAIN][tick] = r1 - r0;
+      samples[PHASE_RENDER_ENTITIES][tick] = r2 - r1;
+      samples[PHASE_RENDER_FOG][tick] = r3 - r2;
+      samples[PHASE_RENDER_HUD][tick] = r4 - r3;
+      samples[PHASE_RENDER_PRESENT][tick] = r5 - r4;
+      samples[PHASE_RENDER][tick] = r5 - r0;
+    }
+#endif
+  }
+
+  fprintf(out, "%s\n    {\n", is_first ? "" : ",");
+  fprintf(out, "      \"name\": \"%s\",\n", sc->name);
+  fprintf(out, "      \"map_w\": %d,\n      \"map_h\": %d,\n", sc->map_w, sc->map_h);
+  fprintf(out, "      \"beasts\": %d,\n      \"turrets\": %d,\n      \"density_pct\": %d,\n", sc->num_beasts, sc->num_turrets, sc->density_pct);
+  fprintf(out, "      \"load_ms\": %.4f,\n", load_ms);
+  fprintf(out, "      \"phases\": {");
+  int num_timed = is_rendering ? NUM_PHASES : PHASE_STEP + 1;
+  for (int i = 0; i < num_timed; ++i)
+    write_stats(out, phase_names[i], samples[i], i == num_timed - 1);
+  fprintf(out, "\n      }\n    }");
+
+  qsort(samples[PHASE_STEP], num_ticks, sizeof(double), compare_doubles);
+  fprintf(stderr, "  load %.1f ms, step p50 %.4f ms, p99 %.4f ms\n", load_ms,
+    samples[PHASE_STEP][num_ticks / 2], samples[PHASE_STEP][num_ticks * 99 / 100]);
+
+  for (int i = 0; i < NUM_PHASES; ++i)
+    free(samples[i]);
+
+#ifdef BENCH_RENDER
+  if (is_rendering) {
+    for (int i = 0; i < num_chunks; ++i)
+      if (chunks[i])
+        SDL_DestroyTexture(chunks[i]);
+    free(chunks);
+    num_chunk_texs = 0;
+    free_hud_texs();
+    SDL_DestroyTexture(fog);
+  }
+#endif
+  stop_workers(&game);
+}
+
+// records how long the phase that just finished took
+void time_phase(Game* game, int phase) {
+  (void)game;
+  double t = now_ms();
+  samples[phase][cur_tick] = t - phase_start;
+  phase_start = t;
+}
+
+// scatters turrets over the map (place_entity() only allows building next to roads/turrets)
+void add_turrets(Game* game, int num_turrets) {
+  Pool* turrets = &game->pools[KIND_TURRET];
+  while (num_turrets > 0) {
+    Ref turret = new_entity(game, KIND_TURRET);
+    if (!turret)
+      break;
+
+    int pos = find_avail_pos(game);
+    turrets->health[ref_slot(turret)] = fortress_health;
+    set_pos(game, turret, pos);
+    update_explored(game, pos);
+    num_turrets--;
+  }
+}
+
+// sorts the samples in place
+void write_stats(FILE* out, char* name, double samples[], bool is_last) {
+  double sum = 0;
+  for (int i = 0; i < num_ticks; ++i)
+    sum += samples[i];
+
+  qsort(samples, num_ticks, sizeof(double), compare_doubles);
+  fprintf(out, "\n        \"%s\": {\"mean_ms\": %.6f, \"p50_ms\": %.6f, \"p99_ms\": %.6f, \"max_ms\": %.6f}%s",
+    name, sum / num_ticks, samples[num_ticks / 2], samples[num_ticks * 99 / 100], samples[num_ticks - 1],
+    is_last ? "" : ",");
+}
+
+int compare_doubles(const void* a, const void* b) {
+  double x = *(double*)a;
+  double y = *(double*)b;
+  return (x > y) - (x < y);
+}
+
+double now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+void usage() {
+  printf("usage: bench [-s seed] [-t ticks] [-f filter] [-o out.json] [-j threads] [-r]\n");
+  exit(-1);
+}
+
+#ifdef BENCH_RENDER
+// a hidden window the size of a typical screen, w/o vsync so presenting doesn't wait
+void init_rendering() {
+  if (SDL_Init(SDL_INIT_VIDEO) < 0)
+    error("initializing SDL");
+
+  vp.w = 1280;
+  vp.h = 720;
+  calc_max_chunk_texs();
+  window = SDL_CreateWindow("bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, vp.w, vp.h, SDL_WINDOW_HIDDEN);
+  if (!window)
+    error("creating window");
+
+  renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_TARGETTEXTURE);
+  if (!renderer)
+    error("creating renderer");
+  if (SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND) < 0)
+    error("setting blend mode");
+
+  sprites = IMG_LoadTexture(renderer, "images/spritesheet.png");
+  if (!sprites)
+    error("loading sprites");
+  ui_bar_img = load_img(renderer, "images/ui-bar.png");
+}
+#endif
@@ -0,0 +1,128 @@
+// runs the simulation w/o a window, for profiling & soak tests
+// usage: headless [-s seed] [-t ticks] [-w width] [-h height] [-b beasts] [-k kernel] [-j threads]
+// -k forces the bullet kernel (scalar/sse2/avx), to check they all give the same results
+#include <stdbool.h>
+#include <time.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+
+uint64_t seed;
+int num_ticks = 10000;
+char* kernel_name = NULL; // NULL for the fastest one the CPU supports
+
+void run();
+uint32_t hash_game(Game* game);
+void set_kernel(Game* game, char* name);
+void usage();
+
+int main(int num_args, char* args[]) {
+  seed = time(NULL);
+  for (int i = 1; i < num_args; ++i) {
+    if (i + 1 >= num_args)
+      usage();
+
+    char* flag = args[i];
+    int val = atoi(args[++i]);
+    if (!strcmp(flag, "-s"))
+      seed = strtoull(args[i], NULL, 10);
+    else if (!strcmp(flag, "-t"))
+      num_ticks = val;
+    else if (!strcmp(flag, "-w"))
+      num_blocks_w = val;
+    else if (!strcmp(flag, "-h"))
+      num_blocks_h = val;
+    else if (!strcmp(flag, "-b"))
+      num_starting_beasts = val;
+    else if (!strcmp(flag, "-k"))
+      kernel_name = args[i];
+    else if (!strcmp(flag, "-j"))
+      num_threads = val;
+    else
+      usage();
+  }
+
+  if (num_ticks < 0 || num_blocks_w <= 0 || num_blocks_h <= 0 || num_starting_beasts < 0 || num_threads < 0)
+    usage();
+  if (num_starting_beasts > max_beasts)
+    max_beasts = num_starting_beasts;
+
+  run();
+  return 0;
+}
+
+void run() {
+  Game game = {.seed = seed};
+  calc_level_sizes(&game);
+
+  Arena arena;
+  arena_init(&arena, calc_level_bytes(&game));
+  alloc_level(&game, &arena);
+
+  clock_t load_start = clock();
+  load(&game);
+  if (kernel_name)
+    set_kernel(&game, kernel_name);
+  clock_t step_start = clock();
+  for (int i = 0; i < num_ticks; ++i)
+    step(&game, tick_dt);
+  clock_t end = clock();
+
+  int num_beasts = game.pools[KIND_BEAST].slots.num_live;
+  int num_turrets = game.pools[KIND_TURRET].slots.num_live;
+  double load_ms = (step_start - load_start) * 1000.0 / CLOCKS_PER_SEC;
+  double step_ms = (end - step_start) * 1000.0 / CLOCKS_PER_SEC;
+  printf("map: %dx%d, seed: %llu, bullet kernel: %s\n", game.num_blocks_w, game.num_blocks_h, (unsigned long long)seed, game.bullet_kernel_name);
+  printf("load: %.2f ms\n", load_ms);
+  printf("%d ticks (%.1f sim sec): %.2f ms, %.4f ms/tick\n", num_ticks, game.time / 1000.0, step_ms, num_ticks ? step_ms / num_ticks : 0);
+  printf("beasts: %d, turrets: %d, blocks: %d\n", num_beasts, num_turrets, game.num_collected_blocks);
+  printf("state hash: %08x\n", hash_game(&game));
+  stop_workers(&game);
+  arena_free(&arena);
+}
+
+// FNV-1a over the grid, so runs w/ the same seed can be checked for identical results
+uint32_t hash_game(Game* game) {
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < game->grid_len; ++i) {
+    Ref ref = game->grid[i];
+    int x = to_x(game, i);
+    int y = to_y(game, i);
+    uint32_t terrain = get_bit(game, game->water, x, y) | get_bit(game, game->roads, x, y) << 1 | get_bit(game, game->explored, x, y) << 2;
+    uint32_t vals[4] = {terrain, ref, 0, 0};
+    if (ref) {
+      Pool* pool = ref_pool(game, ref);
+      vals[2] = pool->flags[ref_slot(ref)] | (is_powered(game, ref) ? POWER : 0);
+      vals[3] = pool->health[ref_slot(ref)];
+    }
+    for (int j = 0; j < 4; ++j)
+      hash = (hash ^ vals[j]) * 16777619u;
+  }
+  for (int i = 0; i < game->bullets.num; ++i) {
+    int vals[2] = {(int)game->bullets.x[i], (int)game->bullets.y[i]};
+    for (int j = 0; j < 2; ++j)
+      hash = (hash ^ (uint32_t)vals[j]) * 16777619u;
+  }
+  return hash;
+}
+
+void set_kernel(Game* game, char* name) {
+  game->bullet_kernel_name = name;
+  if (!strcmp(name, "scalar"))
+    game->advance_bullets = advance_bullets_scalar;
+#ifdef HAS_X86_KERNELS
+  else if (!strcmp(name, "sse2"))
+    game->advance_bullets = advance_bullets_sse2;
+  else if (!strcmp(name, "avx"))
+    game->advance_bullets = advance_bullets_avx;
+#endif
+  else
+    usage();
+}
+
+void usage() {
+  printf("usage: headless [-s seed] [-t ticks] [-w width] [-h height] [-b beasts] [-k kernel] [-j threads]\n");
+  exit(-1);
+}
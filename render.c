@@ -0,0 +1,706 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "SDL_image.h"
+#include "font8x8_basic.h"
+#include "sim.h"
+#include "render.h"
+
+Viewport vp = {};
+
+int bullet_w = 4;
+int bullet_h = 4;
+
+// land, blocks & roads are pre-rendered into chunks of chunk_size x chunk_size tiles
+// which are only redrawn when something on (or next to) one of their tiles changes
+int num_chunk_texs = 0;
+int max_chunk_texs; // beyond this, off-screen chunk textures get freed (see calc_max_chunk_texs())
+
+// sprites & solid rects are queued up & drawn w/ one call per layer, instead of one call per quad
+Batch sprite_batch = {};
+Batch fill_batch = {};
+
+// the HUD is drawn into hud_tex, which is only redrawn when what's on it changes
+// (or is_hud_dirty is set, e.g. b/c the render targets were reset)
+SDL_Texture* hud_tex = NULL;
+SDL_Texture* glyph_atlas = NULL;
+int hud_h = 75;
+bool is_hud_dirty = true;
+int hud_num_blocks = -1;
+SDL_Rect* hud_selected_btn = NULL;
+SDL_Rect* hud_hover_btn = NULL;
+double step_ms = 0; // how long a sim step took, averaged over the last frame that ran any (set by the game loop)
+
+SDL_Color land_color = {145, 103, 47, 255};
+SDL_Color bullet_color = {255, 255, 255, 255};
+
+// the spritesheet cell for each combination of ROAD_* neighbours
+// (roads w/ 3 neighbours use the T pieces, & dead ends use the straight pieces)
+int road_sprites[16][2] = {
+  {3,2}, // none
+  {3,1}, // above
+  {3,1}, // below
+  {3,1}, // above & below
+  {3,2}, // left
+  {4,3}, // above & left
+  {4,4}, // below & left
+  {4,1}, // above, below & left
+  {3,2}, // right
+  {5,3}, // above & right
+  {5,4}, // below & right
+  {5,1}, // above, below & right
+  {3,2}, // left & right
+  {4,2}, // above, left & right
+  {5,2}, // below, left & right
+  {3,3}  // all
+};
+
+SDL_Rect road_btn = {.x = 0, .y = 5, .w = 50, .h = 50};
+SDL_Rect fortress_btn = {.x = 0, .y = 5, .w = 50, .h = 50};
+SDL_Rect bridge_btn = {.x = 0, .y = 5, .w = 50, .h = 50};
+SDL_Rect* selected_btn = &fortress_btn;
+SDL_Rect* hover_btn = NULL;
+SDL_Cursor* arrow_cursor = NULL;
+SDL_Cursor* hand_cursor = NULL;
+
+// alpha is how far (0-1) real time is between the last sim step & the next one
+void render(SDL_Renderer* renderer, Image* ui_bar_img, SDL_Texture* sprites, SDL_Texture* chunks[], SDL_Texture* fog, Game* game, double alpha) {
+  // set BG color
+  if (SDL_SetRenderDrawColor(renderer, 44, 34, 30, 255) < 0)
+    error("setting bg color");
+  if (SDL_RenderClear(renderer) < 0)
+    error("clearing renderer");
+
+  // only walk the tiles that are on-screen
+  TileRect vis = calc_visible_tiles(game);
+
+  render_terrain(renderer, sprites, chunks, game, &vis);
+  render_entities(renderer, sprites, game, &vis, alpha);
+  render_fog(renderer, fog, game, &vis);
+  render_hud(renderer, ui_bar_img, game);
+
+  SDL_RenderPresent(renderer);
+}
+
+void render_terrain(SDL_Renderer* renderer, SDL_Texture* sprites, SDL_Texture* chunks[], Game* game, TileRect* vis) {
+  // draw land, blocks & roads from the cached terrain chunks,
+  // redrawing the ones that have changed since they were last drawn
+  TileRect vis_chunks = {
+    .x1 = vis->x1 / chunk_size,
+    .y1 = vis->y1 / chunk_size,
+    .x2 = vis->x2 / chunk_size,
+    .y2 = vis->y2 / chunk_size
+  };
+  for (int chunk_y = vis_chunks.y1; chunk_y <= vis_chunks.y2; ++chunk_y) {
+    for (int chunk_x = vis_chunks.x1; chunk_x <= vis_chunks.x2; ++chunk_x) {
+      int i = chunk_x + chunk_y * game->num_chunks_w;
+      if (!chunks[i]) {
+        chunks[i] = create_chunk_tex(renderer, chunks, &vis_chunks, game);
+        game->dirty_chunks[i] = true;
+      }
+
+      if (game->dirty_chunks[i]) {
+        render_chunk(renderer, sprites, chunks[i], chunk_x, chunk_y, game);
+        game->dirty_chunks[i] = false;
+      }
+
+      SDL_Rect chunk_rect = {
+        .x = chunk_x * chunk_size * block_w - vp.x,
+        .y = chunk_y * chunk_size * block_h - vp.y,
+        .w = chunk_size * block_w,
+        .h = chunk_size * block_h
+      };
+      if (SDL_RenderCopy(renderer, chunks[i], NULL, &chunk_rect) < 0)
+        error("copying terrain chunk");
+    }
+  }
+}
+
+void render_entities(SDL_Renderer* renderer, SDL_Texture* sprites, Game* game, TileRect* vis, double alpha) {
+  Ref* grid = game->grid;
+  Bullets* bullets = &game->bullets;
+  Pool* beasts = &game->pools[KIND_BEAST];
+
+  // draw turrets
+  // (looked up via the grid so off-screen entities are never touched)
+  for (int y = vis->y1; y <= vis->y2; ++y) {
+    for (int x = vis->x1; x <= vis->x2; ++x) {
+      Ref ref = grid[to_pos(game, x, y)];
+      if (ref_kind(ref) != KIND_TURRET)
+        continue;
+
+      if (is_powered(game, ref))
+        render_sprite(renderer, sprites, 2,0, x,y);
+      else
+        render_sprite(renderer, sprites, 0,0, x,y);
+    }
+  }
+  flush_batch(renderer, &sprite_batch);
+
+  for (int i = 0; i < bullets->num; ++i) {
+    // draw it between its last two positions, so it moves smoothly at any frame rate
+    int x = bullets->prev_x[i] + (bullets->x[i] - bullets->prev_x[i]) * alpha - vp.x;
+    int y = bullets->prev_y[i] + (bullets->y[i] - bullets->prev_y[i]) * alpha - vp.y;
+    if (x + bullet_w < 0 || x >= vp.w || y + bullet_h < 0 || y >= vp.h)
+      continue;
+
+    SDL_Rect bullet_rect = {
+      .x = x,
+      .y = y,
+      .w = bullet_w,
+      .h = bullet_h
+    };
+    batch_fill(renderer, &fill_batch, &bullet_rect, bullet_color);
+  }
+  flush_batch(renderer, &fill_batch);
+
+  // draw beasts (in & out of water) & nests
+  for (int y = vis->y1; y <= vis->y2; ++y) {
+    for (int x = vis->x1; x <= vis->x2; ++x) {
+      int i = to_pos(game, x, y);
+      Ref ref = grid[i];
+      int kind = ref_kind(ref);
+      if (!is_enemy_kind(kind))
+        continue;
+
+      if (kind == KIND_NEST) {
+        render_sprite(renderer, sprites, 5,0, x,y);
+        continue;
+      }
+
+      int sprite_x_pos = 0;
+      int sprite_y_pos = 1;
+      if (get_bit(game, game->water, x, y))
+        sprite_y_pos += 1;
+      byte health = beasts->health[ref_slot(ref)];
+      if (health == 2)
+        sprite_x_pos = 1;
+      else if (health == 1)
+        sprite_x_pos = 2;
+
+      render_sprite(renderer, sprites, sprite_x_pos,sprite_y_pos, x,y);
+    }
+  }
+
+  // draw bridges (roads on water), finding them a word of each row at a time
+  for (int y = vis->y1; y <= vis->y2; ++y) {
+    for (int i = vis->x1 / 64; i <= vis->x2 / 64; ++i) {
+      int word = y * game->mask_w + i;
+      uint64_t bridges = game->roads[word] & game->water[word] & span_bits(i, vis->x1, vis->x2);
+      for (; bridges; bridges &= bridges - 1)
+        render_sprite(renderer, sprites, 0,3, i * 64 + __builtin_ctzll(bridges),y);
+    }
+  }
+  flush_batch(renderer, &sprite_batch);
+}
+
+void render_fog(SDL_Renderer* renderer, SDL_Texture* fog, Game* game, TileRect* vis) {
+  // draw black unexplored mask, uploading the tiles that have been explored since last frame
+  if (game->explored_dirty.x1 <= game->explored_dirty.x2) {
+    update_fog(fog, game, &game->explored_dirty);
+    game->explored_dirty = empty_rect;
+  }
+
+  // the fog texture has one texel per tile, so scaling it up w/ linear filtering
+  // fades the mask out over the tiles bordering the explored area
+  SDL_Rect fog_src = {
+    .x = vis->x1,
+    .y = vis->y1,
+    .w = vis->x2 - vis->x1 + 1,
+    .h = vis->y2 - vis->y1 + 1
+  };
+  SDL_Rect fog_dest = {
+    .x = vis->x1 * block_w - vp.x,
+    .y = vis->y1 * block_h - vp.y,
+    .w = fog_src.w * block_w,
+    .h = fog_src.h * block_h
+  };
+  if (SDL_RenderCopy(renderer, fog, &fog_src, &fog_dest) < 0)
+    error("copying unexplored mask");
+}
+
+void render_hud(SDL_Renderer* renderer, Image* ui_bar_img, Game* game) {
+  int control_x = vp.w/2 - ui_bar_img->w/2;
+  ui_bar_img->x = control_x;
+  road_btn.x = control_x + 5;
+  fortress_btn.x = control_x + 98;
+  bridge_btn.x = control_x + 184;
+
+  int mouse_x, mouse_y;
+  SDL_GetMouseState(&mouse_x, &mouse_y);
+  
+  if (contains(&road_btn, mouse_x, mouse_y))
+    hover_btn = &road_btn;
+  else if (contains(&fortress_btn, mouse_x, mouse_y))
+    hover_btn = &fortress_btn;
+  else if (contains(&bridge_btn, mouse_x, mouse_y))
+    hover_btn = &bridge_btn;
+  else
+    hover_btn = NULL;
+  SDL_SetCursor(hover_btn ? hand_cursor : arrow_cursor);
+
+  // (re)create the HUD texture if the window's width has changed
+  int hud_w = 0;
+  if (hud_tex && SDL_QueryTexture(hud_tex, NULL, NULL, &hud_w, NULL) < 0)
+    error("querying hud texture");
+  if (hud_w != vp.w) {
+    if (hud_tex)
+      SDL_DestroyTexture(hud_tex);
+    hud_tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, vp.w, hud_h);
+    if (!hud_tex)
+      error("creating hud texture");
+    if (SDL_SetTextureBlendMode(hud_tex, SDL_BLENDMODE_NONE) < 0)
+      error("setting hud blend mode");
+    is_hud_dirty = true;
+  }
+
+  if (is_hud_dirty || hud_num_blocks != game->num_collected_blocks || hud_selected_btn != selected_btn || hud_hover_btn != hover_btn) {
+    if (SDL_SetRenderTarget(renderer, hud_tex) < 0)
+      error("setting hud render target");
+    draw_hud(renderer, ui_bar_img, game);
+    if (SDL_SetRenderTarget(renderer, NULL) < 0)
+      error("resetting render target");
+
+    hud_num_blocks = game->num_collected_blocks;
+    hud_selected_btn = selected_btn;
+    hud_hover_btn = hover_btn;
+    is_hud_dirty = false;
+  }
+
+  SDL_Rect hud_rect = {.x = 0, .y = 0, .w = vp.w, .h = hud_h};
+  if (SDL_RenderCopy(renderer, hud_tex, NULL, &hud_rect) < 0)
+    error("copying hud");
+
+  // live stats (changing every frame, so they're drawn on top of the cached HUD)
+  Pool* turrets = &game->pools[KIND_TURRET];
+  char stats[128];
+  snprintf(stats, sizeof(stats), "beasts %d  bullets %d  fortresses %d/%d  step %.2f ms",
+    game->pools[KIND_BEAST].slots.num_live, game->bullets.num, turrets->slots.num_live, turrets->slots.cap, step_ms);
+  int text_px_size = 1;
+  render_text(renderer, stats, vp.w - (int)strlen(stats) * 8 * text_px_size - 10, 10, text_px_size);
+  flush_batch(renderer, &sprite_batch);
+}
+
+// draws the header bar, buttons & coin bar into the HUD texture
+void draw_hud(SDL_Renderer* renderer, Image* ui_bar_img, Game* game) {
+  // header
+  if (SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255) < 0)
+    error("setting header color");
+  SDL_Rect header_rect = {
+    .x = 0,
+    .y = 0,
+    .w = vp.w,
+    .h = hud_h
+  };
+  if (SDL_RenderFillRect(renderer, &header_rect) < 0)
+    error("filling header rect");
+
+  if (hover_btn) {
+    if (SDL_SetRenderDrawColor(renderer, 44, 34, 30, 100) < 0)
+      error("setting hover btn bg color");
+    if (SDL_RenderFillRect(renderer, hover_btn) < 0)
+      error("filling hover_btn rect");
+  }
+
+  if (SDL_SetRenderDrawColor(renderer, 44, 34, 30, 255) < 0)
+    error("setting selected btn bg color");
+
+  if (SDL_RenderFillRect(renderer, selected_btn) < 0)
+    error("filling selected_btn rect");
+
+  if (SDL_SetRenderDrawColor(renderer, 227, 167, 11, 255) < 0)
+    error("setting selected btn highlight");
+
+  SDL_Rect selected_btn_highlight = {
+    .x = selected_btn->x, .y = selected_btn->y, .w = selected_btn->w, .h = 3
+  };
+  if (SDL_RenderFillRect(renderer, &selected_btn_highlight) < 0)
+    error("filling selected btn highlight");
+
+  render_img(renderer, ui_bar_img);
+
+  if (SDL_SetRenderDrawColor(renderer, 59, 59, 59, 255) < 0)
+    error("setting filled coin bar color");
+
+  double coin_bar_len = 0;
+  if (game->num_collected_blocks <= 40)
+    coin_bar_len = game->num_collected_blocks * 5;
+  else if (game->num_collected_blocks <= 80)
+    coin_bar_len = 40.0 * 5.0 + (game->num_collected_blocks - 40.0) * 2.5;
+  else if (game->num_collected_blocks <= 120)
+    coin_bar_len = 40.0 * (5.0 + 2.5) + (game->num_collected_blocks - 80.0) * 1.25;
+  else if (game->num_collected_blocks <= 160)
+    coin_bar_len = 40.0 * (5.0 + 2.5 + 1.25) + (game->num_collected_blocks - 120.0) * 0.625;
+  else if (game->num_collected_blocks <= 200)
+    coin_bar_len = 40.0 * (5.0 + 2.5 + 1.25 + 0.625) + (game->num_collected_blocks - 160.0) * 0.3125;
+  else if (game->num_collected_blocks <= 240)
+    coin_bar_len = 40.0 * (5.0 + 2.5 + 1.25 + 0.625 + 0.3125) + (game->num_collected_blocks - 200.0) * 0.15625;
+  else if (game->num_collected_blocks <= 280)
+    coin_bar_len = 40.0 * (5.0 + 2.5 + 1.25 + 0.625 + 0.3125 + 0.15625) + (game->num_collected_blocks - 240.0) * 0.078125;
+  else
+    coin_bar_len = 40.0 * (5.0 + 2.5 + 1.25 + 0.625 + 0.3125 + 0.15625 + 0.078125);
+
+  SDL_Rect coin_bar_rect = {
+    .x = ui_bar_img->x + 10,
+    .y = 60,
+    .w = (int)coin_bar_len,
+    .h = 5
+  };
+  if (SDL_RenderFillRect(renderer, &coin_bar_rect) < 0)
+    error("filling header rect");
+
+  if (SDL_SetRenderDrawColor(renderer, 0, 0, 0, 170) < 0)
+    error("setting disabled overlay color");
+
+  if (game->num_collected_blocks < num_blocks_per_road)
+    if (SDL_RenderFillRect(renderer, &road_btn) < 0)
+      error("filling disabled overlay");
+
+  if (game->num_collected_blocks < num_blocks_per_turret)
+    if (SDL_RenderFillRect(renderer, &fortress_btn) < 0)
+      error("filling disabled overlay");
+
+  if (game->num_collected_blocks < num_blocks_per_bridge)
+    if (SDL_RenderFillRect(renderer, &bridge_btn) < 0)
+      error("filling disabled overlay");
+}
+
+// the range of tiles that are (at least partially) inside the viewport
+TileRect calc_visible_tiles(Game* game) {
+  TileRect r = {
+    .x1 = clamp(vp.x / block_w, 0, game->num_blocks_w - 1),
+    .y1 = clamp(vp.y / block_h, 0, game->num_blocks_h - 1),
+    .x2 = clamp((vp.x + vp.w - 1) / block_w, 0, game->num_blocks_w - 1),
+    .y2 = clamp((vp.y + vp.h - 1) / block_h, 0, game->num_blocks_h - 1)
+  };
+  return r;
+}
+
+// caps the chunk textures at the most chunks the viewport can overlap, w/ a ring of chunks around them
+// so scrolling back & forth doesn't keep redrawing them (call it when the viewport's size changes)
+void calc_max_chunk_texs() {
+  int vis_w = (vp.w + chunk_size * block_w - 1) / (chunk_size * block_w) + 1;
+  int vis_h = (vp.h + chunk_size * block_h - 1) / (chunk_size * block_h) + 1;
+  max_chunk_texs = (vis_w + 2) * (vis_h + 2);
+}
+
+// draws a chunk's land, blocks & roads into its texture
+void render_chunk(SDL_Renderer* renderer, SDL_Texture* sprites, SDL_Texture* chunk, int chunk_x, int chunk_y, Game* game) {
+  Ref* grid = game->grid;
+
+  if (SDL_SetRenderTarget(renderer, chunk) < 0)
+    error("setting chunk render target");
+
+  if (SDL_SetRenderDrawColor(renderer, 44, 34, 30, 255) < 0)
+    error("setting bg color");
+  if (SDL_RenderClear(renderer) < 0)
+    error("clearing chunk");
+
+  // the render_*() functions draw relative to the viewport,
+  // so point it at the chunk's top/left corner while we draw
+  Viewport screen_vp = vp;
+  vp.x = chunk_x * chunk_size * block_w;
+  vp.y = chunk_y * chunk_size * block_h;
+
+  int x1 = chunk_x * chunk_size;
+  int y1 = chunk_y * chunk_size;
+  int x2 = clamp(x1 + chunk_size, 0, game->num_blocks_w) - 1;
+  int y2 = clamp(y1 + chunk_size, 0, game->num_blocks_h) - 1;
+
+  for (int y = y1; y <= y2; ++y)
+    for (int x = x1; x <= x2; ++x)
+      render_land(renderer, sprites, game->coast_codes[to_pos(game, x, y)], x, y);
+
+  // the land rects don't overlap the coastline corners, but they have to be under the blocks & roads
+  flush_batch(renderer, &fill_batch);
+
+  // blocks & power stones (turrets are drawn every frame since they can be powered up)
+  for (int y = y1; y <= y2; ++y) {
+    for (int x = x1; x <= x2; ++x) {
+      int kind = ref_kind(grid[to_pos(game, x, y)]);
+      if (kind != KIND_BLOCK && kind != KIND_STONE)
+        continue;
+
+      if (kind == KIND_STONE)
+        render_sprite(renderer, sprites, 1,0, x,y);
+      else
+        render_sprite(renderer, sprites, 1,3, x,y);
+    }
+  }
+
+  // roads on land (bridges are drawn over the water every frame)
+  for (int y = y1; y <= y2; ++y) {
+    for (int i = x1 / 64; i <= x2 / 64; ++i) {
+      int word = y * game->mask_w + i;
+      uint64_t roads = game->roads[word] & ~game->water[word] & span_bits(i, x1, x2);
+      for (; roads; roads &= roads - 1)
+        render_road(renderer, sprites, game, i * 64 + __builtin_ctzll(roads), y);
+    }
+  }
+  flush_batch(renderer, &sprite_batch);
+
+  vp = screen_vp;
+  if (SDL_SetRenderTarget(renderer, NULL) < 0)
+    error("resetting render target");
+}
+
+// creates a chunk texture, first freeing off-screen ones if we're at max_chunk_texs
+// (there can be several over it after the window shrinks)
+SDL_Texture* create_chunk_tex(SDL_Renderer* renderer, SDL_Texture* chunks[], TileRect* vis_chunks, Game* game) {
+  for (int i = 0; i < game->num_chunks_w * game->num_chunks_h && num_chunk_texs >= max_chunk_texs; ++i) {
+    int chunk_x = i % game->num_chunks_w;
+    int chunk_y = i / game->num_chunks_w;
+    if (!chunks[i] || (chunk_x >= vis_chunks->x1 && chunk_x <= vis_chunks->x2 &&
+      chunk_y >= vis_chunks->y1 && chunk_y <= vis_chunks->y2))
+        continue;
+
+    SDL_DestroyTexture(chunks[i]);
+    chunks[i] = NULL;
+    num_chunk_texs--;
+  }
+
+  SDL_Texture* tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, chunk_size * block_w, chunk_size * block_h);
+  if (!tex)
+    error("creating chunk texture");
+  if (SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_NONE) < 0)
+    error("setting chunk blend mode");
+
+  num_chunk_texs++;
+  return tex;
+}
+
+// one texel per tile: opaque black when unexplored, transparent when explored
+SDL_Texture* create_fog_tex(SDL_Renderer* renderer, Game* game) {
+  SDL_Texture* tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, game->num_blocks_w, game->num_blocks_h);
+  if (!tex)
+    error("creating fog texture");
+  if (SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND) < 0)
+    error("setting fog blend mode");
+  if (SDL_SetTextureScaleMode(tex, SDL_ScaleModeLinear) < 0)
+    error("setting fog scale mode");
+  return tex;
+}
+
+void update_fog(SDL_Texture* fog, Game* game, TileRect* r) {
+  SDL_Rect rect = {.x = r->x1, .y = r->y1, .w = r->x2 - r->x1 + 1, .h = r->y2 - r->y1 + 1};
+  void* pixels;
+  int pitch;
+  if (SDL_LockTexture(fog, &rect, &pixels, &pitch) < 0)
+    error("locking fog texture");
+
+  for (int y = r->y1; y <= r->y2; ++y) {
+    Uint32* row = (Uint32*)((Uint8*)pixels + (y - r->y1) * pitch);
+    for (int x = r->x1; x <= r->x2; ++x)
+      row[x - r->x1] = get_bit(game, game->explored, x, y) ? 0x00000000 : 0xFF000000;
+  }
+  SDL_UnlockTexture(fog);
+}
+
+void render_land(SDL_Renderer* renderer, SDL_Texture* sprites, byte coast_code, int x, int y) {
+  for (int corner_x = 0; corner_x <= 1; ++corner_x) {
+    for (int corner_y = 0; corner_y <= 1; ++corner_y) {
+      int code = coast_code >> ((corner_y * 2 + corner_x) * 2) & 3;
+      if (code == COAST_OUTER) {
+        render_corner(renderer, sprites, 6 + corner_x, 0 + corner_y, x * 2 + corner_x, y * 2 + corner_y);
+      }
+      else if (code == COAST_INNER) {
+        render_corner(renderer, sprites, 8 + corner_x, 0 + corner_y, x * 2 + corner_x, y * 2 + corner_y);
+      }
+      else if (code == COAST_LAND) {
+        SDL_Rect land_rect = {
+          .x = x * block_w + corner_x * block_w/2 - vp.x,
+          .y = y * block_h + corner_y * block_h/2 - vp.y,
+          .w = block_w/2,
+          .h = block_h/2
+        };
+        batch_fill(renderer, &fill_batch, &land_rect, land_color);
+      }
+    }
+  }
+}
+
+void render_road(SDL_Renderer* renderer, SDL_Texture* sprites, Game* game, int x, int y) {
+  int* cell = road_sprites[game->road_masks[to_pos(game, x, y)]];
+  render_sprite(renderer, sprites, cell[0],cell[1], x,y);
+}
+
+
+// Generic Functions
+
+// draws the text in white, from the glyph atlas (which is created on first use)
+// the glyphs are queued in sprite_batch, so it has to be flushed before anything's drawn over them
+int render_text(SDL_Renderer* renderer, char str[], int offset_x, int offset_y, int size) {
+  if (!glyph_atlas)
+    glyph_atlas = create_glyph_atlas(renderer);
+
+  int i;
+  for (i = 0; str[i] != '\0'; ++i) {
+    int code = str[i];
+    if (code < 0 || code > 127)
+      error("Text code out of range");
+    if (code == ' ')
+      continue;
+
+    SDL_Rect src = {.x = code % 16 * 8, .y = code / 16 * 8, .w = 8, .h = 8};
+    SDL_Rect dest = {.x = offset_x + i * size * 8, .y = offset_y, .w = size * 8, .h = size * 8};
+    batch_copy(renderer, &sprite_batch, glyph_atlas, &src, &dest);
+  }
+
+  // width of total text string
+  return i * size * 8;
+}
+
+// bakes the 128 font8x8_basic glyphs into a 16x8 grid of 8x8 pixel cells, white on transparent
+SDL_Texture* create_glyph_atlas(SDL_Renderer* renderer) {
+  int w = 16 * 8;
+  int h = 8 * 8;
+  Uint32* pixels = malloc(w * h * sizeof(Uint32));
+  if (!pixels)
+    error("allocating glyph atlas pixels");
+
+  for (int code = 0; code < 128; ++code) {
+    char* bitmap = font8x8_basic[code];
+    for (int y = 0; y < 8; ++y)
+      for (int x = 0; x < 8; ++x)
+        pixels[(code / 16 * 8 + y) * w + code % 16 * 8 + x] = bitmap[y] & 1 << x ? 0xFFFFFFFF : 0x00000000;
+  }
+
+  SDL_Texture* tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, w, h);
+  if (!tex)
+    error("creating glyph atlas");
+  if (SDL_UpdateTexture(tex, NULL, pixels, w * sizeof(Uint32)) < 0)
+    error("uploading glyph atlas");
+  if (SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND) < 0)
+    error("setting glyph atlas blend mode");
+  if (SDL_SetTextureScaleMode(tex, SDL_ScaleModeNearest) < 0)
+    error("setting glyph atlas scale mode");
+  free(pixels);
+  return tex;
+}
+
+// frees the HUD's textures (they're recreated the next time they're needed)
+void free_hud_texs() {
+  if (hud_tex)
+    SDL_DestroyTexture(hud_tex);
+  if (glyph_atlas)
+    SDL_DestroyTexture(glyph_atlas);
+  hud_tex = NULL;
+  glyph_atlas = NULL;
+}
+
+// TODO: it's probably a little more efficient to load the image into an sdl image
+// then get the dimensions, then load it into a texture
+// instead of loading it directly to a texture & then querying the texture...
+Image load_img(SDL_Renderer* renderer, char* path) {
+  Image img = {};
+  img.tex = IMG_LoadTexture(renderer, path);
+  SDL_QueryTexture(img.tex, NULL, NULL, &img.w, &img.h);
+  return img;
+}
+
+void render_img(SDL_Renderer* renderer, Image* img) {
+  SDL_Rect r = {.x = img->x, .y = img->y, .w = img->w, .h = img->h};
+  if (SDL_RenderCopy(renderer, img->tex, NULL, &r) < 0)
+    error("renderCopy");
+}
+
+// centers the image horizontally in the viewport
+void center_img(Image* img, Viewport* viewport) {
+  img->x = viewport->w / 2 - img->w / 2;
+}
+
+void render_sprite(SDL_Renderer* renderer, SDL_Texture* sprites, int src_x, int src_y, int dest_x, int dest_y) {
+  SDL_Rect src = {.x = src_x * block_w, .y = src_y * block_h, .w = block_w, .h = block_h};
+  SDL_Rect dest = {.x = dest_x * block_w - vp.x, .y = dest_y * block_h - vp.y, .w = block_w, .h = block_h};
+  batch_copy(renderer, &sprite_batch, sprites, &src, &dest);
+}
+
+void render_corner(SDL_Renderer* renderer, SDL_Texture* sprites, int src_x, int src_y, int dest_x, int dest_y) {
+  SDL_Rect src = {.x = src_x * block_w/2, .y = src_y * block_h/2, .w = block_w/2, .h = block_h/2};
+  SDL_Rect dest = {.x = dest_x * block_w/2 - vp.x, .y = dest_y * block_h/2 - vp.y, .w = block_w/2, .h = block_h/2};
+  batch_copy(renderer, &sprite_batch, sprites, &src, &dest);
+}
+
+// queues a copy of part of a texture (flushing first if the batch is for another texture)
+void batch_copy(SDL_Renderer* renderer, Batch* batch, SDL_Texture* tex, SDL_Rect* src, SDL_Rect* dest) {
+  if (tex != batch->tex) {
+    flush_batch(renderer, batch);
+    batch->tex = tex;
+    if (SDL_QueryTexture(tex, NULL, NULL, &batch->tex_w, &batch->tex_h) < 0)
+      error("querying batch texture");
+  }
+
+  SDL_Vertex* verts = add_quad(renderer, batch);
+  float u1 = (float)src->x / batch->tex_w;
+  float v1 = (float)src->y / batch->tex_h;
+  float u2 = (float)(src->x + src->w) / batch->tex_w;
+  float v2 = (float)(src->y + src->h) / batch->tex_h;
+  SDL_Color white = {255, 255, 255, 255};
+  verts[0] = (SDL_Vertex){{dest->x, dest->y}, white, {u1, v1}};
+  verts[1] = (SDL_Vertex){{dest->x + dest->w, dest->y}, white, {u2, v1}};
+  verts[2] = (SDL_Vertex){{dest->x + dest->w, dest->y + dest->h}, white, {u2, v2}};
+  verts[3] = (SDL_Vertex){{dest->x, dest->y + dest->h}, white, {u1, v2}};
+}
+
+// queues a solid color rect (the batch mustn't be used for textures)
+void batch_fill(SDL_Renderer* renderer, Batch* batch, SDL_Rect* dest, SDL_Color color) {
+  SDL_Vertex* verts = add_quad(renderer, batch);
+  verts[0] = (SDL_Vertex){{dest->x, dest->y}, color, {0, 0}};
+  verts[1] = (SDL_Vertex){{dest->x + dest->w, dest->y}, color, {0, 0}};
+  verts[2] = (SDL_Vertex){{dest->x + dest->w, dest->y + dest->h}, color, {0, 0}};
+  verts[3] = (SDL_Vertex){{dest->x, dest->y + dest->h}, color, {0, 0}};
+}
+
+// returns the 4 vertices (clockwise from top/left) for the next quad, drawing the queued ones first if it's full
+SDL_Vertex* add_quad(SDL_Renderer* renderer, Batch* batch) {
+  if (batch->num_quads == MAX_BATCH_QUADS)
+    draw_batch(renderer, batch);
+
+  int vert = batch->num_quads * 4;
+  int* indices = &batch->indices[batch->num_quads * 6];
+  int corners[6] = {0, 1, 2, 0, 2, 3};
+  for (int i = 0; i < 6; ++i)
+    indices[i] = vert + corners[i];
+  batch->num_quads++;
+  return &batch->verts[vert];
+}
+
+// draws everything that's been queued (has to be done before anything else is drawn on top
+// & before switching render targets)
+// it also forgets the texture, b/c it may be destroyed before the next draw & a new texture
+// could get its address (which would skip querying the new one's size)
+void flush_batch(SDL_Renderer* renderer, Batch* batch) {
+  draw_batch(renderer, batch);
+  batch->tex = NULL;
+}
+
+// draws the queued quads, keeping the texture for the ones still to come
+void draw_batch(SDL_Renderer* renderer, Batch* batch) {
+  if (!batch->num_quads)
+    return;
+
+  if (SDL_RenderGeometry(renderer, batch->tex, batch->verts, batch->num_quads * 4, batch->indices, batch->num_quads * 6) < 0)
+    error("rendering batch");
+  batch->num_quads = 0;
+}
+
+// TODO: consolidate w/ below contains()
+bool is_mouseover(Image* img, int x, int y) {
+  return x >= img->x && x <= (img->x + img->w) &&
+    y >= img->y && y <= (img->y + img->h);
+}
+
+// TODO: consolidate w/ above is_mouseover()
+bool contains(SDL_Rect* r, int x, int y) {
+  return x >= r->x && x <= (r->x + r->w) &&
+    y >= r->y && y <= (r->y + r->h);
+}
+
+void error(char* activity) {
+  printf("%s failed: %s\n", activity, SDL_GetError());
+  SDL_Quit();
+  exit(-1);
+}
@@ -0,0 +1,89 @@
+// drawing the game w/ SDL (shared by sardonia & bench's offscreen rendering)
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdbool.h>
+
+#include "SDL.h"
+#include "sim.h"
+
+typedef struct {
+  int x;
+  int y;
+  int w;
+  int h;
+} Viewport;
+
+#define MAX_BATCH_QUADS 4096
+
+// quads queued up to be drawn w/ a single SDL_RenderGeometry() call
+// (all from the same texture, or all solid colors when tex is NULL)
+typedef struct {
+  SDL_Texture* tex;
+  int tex_w;
+  int tex_h;
+  SDL_Vertex verts[MAX_BATCH_QUADS * 4];
+  int indices[MAX_BATCH_QUADS * 6];
+  int num_quads;
+} Batch;
+
+typedef struct {
+  SDL_Texture* tex;
+  int x;
+  int y;
+  int w;
+  int h;
+} Image;
+
+extern Viewport vp;
+extern int bullet_w;
+extern int bullet_h;
+extern int num_chunk_texs;
+extern int max_chunk_texs;
+extern Batch sprite_batch;
+extern Batch fill_batch;
+extern bool is_hud_dirty;
+extern double step_ms;
+
+extern SDL_Rect road_btn;
+extern SDL_Rect fortress_btn;
+extern SDL_Rect bridge_btn;
+extern SDL_Rect* selected_btn;
+extern SDL_Rect* hover_btn;
+extern SDL_Cursor* arrow_cursor;
+extern SDL_Cursor* hand_cursor;
+
+void render(SDL_Renderer* renderer, Image* ui_bar_img, SDL_Texture* sprites, SDL_Texture* chunks[], SDL_Texture* fog, Game* game, double alpha);
+void render_terrain(SDL_Renderer* renderer, SDL_Texture* sprites, SDL_Texture* chunks[], Game* game, TileRect* vis);
+void render_entities(SDL_Renderer* renderer, SDL_Texture* sprites, Game* game, TileRect* vis, double alpha);
+void render_fog(SDL_Renderer* renderer, SDL_Texture* fog, Game* game, TileRect* vis);
+void render_hud(SDL_Renderer* renderer, Image* ui_bar_img, Game* game);
+void draw_hud(SDL_Renderer* renderer, Image* ui_bar_img, Game* game);
+TileRect calc_visible_tiles(Game* game);
+void calc_max_chunk_texs();
+void render_chunk(SDL_Renderer* renderer, SDL_Texture* sprites, SDL_Texture* chunk, int chunk_x, int chunk_y, Game* game);
+SDL_Texture* create_chunk_tex(SDL_Renderer* renderer, SDL_Texture* chunks[], TileRect* vis_chunks, Game* game);
+void render_land(SDL_Renderer* renderer, SDL_Texture* sprites, byte coast_code, int x, int y);
+void render_road(SDL_Renderer* renderer, SDL_Texture* sprites, Game* game, int x, int y);
+SDL_Texture* create_fog_tex(SDL_Renderer* renderer, Game* game);
+void update_fog(SDL_Texture* fog, Game* game, TileRect* r);
+
+// generic functions
+int render_text(SDL_Renderer* renderer, char str[], int offset_x, int offset_y, int size);
+SDL_Texture* create_glyph_atlas(SDL_Renderer* renderer);
+void free_hud_texs();
+Image load_img(SDL_Renderer* renderer, char* path);
+void render_img(SDL_Renderer* renderer, Image* img);
+void center_img(Image* img, Viewport* viewport);
+void render_sprite(SDL_Renderer* renderer, SDL_Texture* sprites, int src_x, int src_y, int dest_x, int dest_y);
+void render_corner(SDL_Renderer* renderer, SDL_Texture* sprites, int src_x, int src_y, int dest_x, int dest_y);
+void batch_copy(SDL_Renderer* renderer, Batch* batch, SDL_Texture* tex, SDL_Rect* src, SDL_Rect* dest);
+void batch_fill(SDL_Renderer* renderer, Batch* batch, SDL_Rect* dest, SDL_Color color);
+SDL_Vertex* add_quad(SDL_Renderer* renderer, Batch* batch);
+void flush_batch(SDL_Renderer* renderer, Batch* batch);
+void draw_batch(SDL_Renderer* renderer, Batch* batch);
+bool is_mouseover(Image* img, int x, int y);
+bool contains(SDL_Rect* r, int x, int y);
+void error(char* activity);
+
+#endif
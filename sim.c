@@ -0,0 +1,1871 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+#ifdef HAS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// settings
+int block_ratio = 2; // you have to collect 2 rocks to build 1 wall
+int num_blocks_per_road = 3;
+int num_blocks_per_turret = 25; // collect 5 rocks to build 1 turret
+int num_blocks_per_refurb = 15; // discount if you "refurbish" an existing block to build a turret
+int num_blocks_per_bridge = 50;
+int beast_attack_dist = 30; // how close a beast has to be before he moves towards you
+int fortress_attack_dist = 10; // how close before a turret fires on a beast/nest
+byte beast_health = 3;
+byte fortress_health = 3;
+byte nest_health = 25;
+int explored_dist = 6; // how many blocks to show next to "explored" areas
+
+int block_w = 40;
+int block_h = 40;
+double bullet_speed = 600.0; // in px/sec
+double tick_dt = 1.0 / 60.0; // length of a fixed sim step, in seconds
+int block_density_pct = 4;
+
+int num_blocks_w = 128; // 2^7
+int num_blocks_h = 128; // 2^7
+
+int beast_move_interval = 500; // ms between beast moves
+int turret_fire_interval = 1000; // ms between turret firing
+int mine_interval = 10000; // ms between mine generating metal
+int beast_spawn_interval = 10000;
+
+int max_beasts = 500;
+int num_starting_beasts = 25;
+int max_turrets = 500;
+int max_bullets = 20000; // bullets that miss fly until they leave the map, so they pile up on big maps
+int max_power_stones = 10;
+int max_nests = 3;
+
+// spatial index: the grid is split into buckets of bucket_size x bucket_size tiles
+// & each bucket keeps a count of the live entities of each kind in it
+int bucket_size = 8;
+
+// the renderer caches land, blocks & roads in chunks of chunk_size x chunk_size tiles
+// the sim flags the chunks it changes in Game.dirty_chunks
+int chunk_size = 16;
+
+TileRect empty_rect = {.x1 = INT_MAX, .y1 = INT_MAX, .x2 = -1, .y2 = -1};
+
+// the data-parallel phases (see parallel_for()) are split across this many threads,
+// including the one that calls step() (0 means one per core)
+// it's read by calc_level_sizes(), so set it before then
+int num_threads = 0;
+
+// the phases of a step, in the order step() runs them
+Phase step_phases[NUM_STEP_PHASES] = {
+  {"mine", mine_blocks},
+  {"fire", fire_turrets},
+  {"spawn", spawn_beasts},
+  {"move_beasts", move_beasts},
+  {"move_bullets", move_bullets}
+};
+
+// sets the Game's sizes (grid_len, max_blocks etc.) from the current settings
+// call before allocating the Game's arrays
+void calc_level_sizes(Game* game) {
+  // entity positions are stored as 16-bit ints
+  if (num_blocks_w > 65536 || num_blocks_h > 65536)
+    sim_error("sizing level (map is too big)");
+
+  game->num_blocks_w = num_blocks_w;
+  game->num_blocks_h = num_blocks_h;
+  game->grid_len = num_blocks_w * num_blocks_h;
+  game->max_blocks = game->grid_len * block_density_pct * 3 / 100; // x3 b/c default is 20% density, but we need up to 60% due to mines
+  game->max_beasts = max_beasts;
+  game->max_turrets = max_turrets;
+  game->max_bullets = max_bullets;
+  game->max_power_stones = max_power_stones;
+  game->max_nests = max_nests;
+
+  // each pool's slots have to fit in a Ref
+  for (int kind = 0; kind < NUM_KINDS; ++kind)
+    if (kind_cap(game, kind) > SLOT_MASK + 1)
+      sim_error("sizing level (too many entities for a Ref)");
+
+  game->num_buckets_w = (num_blocks_w + bucket_size - 1) / bucket_size;
+  game->num_buckets_h = (num_blocks_h + bucket_size - 1) / bucket_size;
+
+  game->num_chunks_w = (num_blocks_w + chunk_size - 1) / chunk_size;
+  game->num_chunks_h = (num_blocks_h + chunk_size - 1) / chunk_size;
+
+  game->mask_w = (num_blocks_w + 63) / 64;
+
+  game->num_water_levels = 0;
+  while ((1 << game->num_water_levels) < num_blocks_w || (1 << game->num_water_levels) < num_blocks_h)
+    game->num_water_levels++;
+
+  int n = num_threads;
+#ifdef _SC_NPROCESSORS_ONLN
+  if (!n)
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  game->num_shares = n > 1 ? n : 1;
+}
+
+// how big an arena alloc_level() needs (call calc_level_sizes() first)
+size_t calc_level_bytes(Game* game) {
+  Arena measure = {.base = NULL, .size = SIZE_MAX, .used = 0};
+  Game sized = *game;
+  alloc_level(&sized, &measure);
+  return measure.used;
+}
+
+// carves the Game's arrays out of the arena
+// (load() initializes them all, so the arena doesn't need to be zeroed)
+void alloc_level(Game* game, Arena* arena) {
+  game->grid = arena_alloc(arena, game->grid_len * sizeof(Ref));
+  game->water = arena_alloc(arena, game->num_blocks_h * game->mask_w * sizeof(uint64_t));
+  game->roads = arena_alloc(arena, game->num_blocks_h * game->mask_w * sizeof(uint64_t));
+  game->explored = arena_alloc(arena, game->num_blocks_h * game->mask_w * sizeof(uint64_t));
+  game->plane_scratch = arena_alloc(arena, game->num_blocks_h * game->mask_w * sizeof(uint64_t));
+  game->water_vals = arena_alloc(arena, game->num_shares * (game->num_water_levels + 1) * game->num_blocks_w * sizeof(short));
+  game->coast_codes = arena_alloc(arena, game->grid_len * sizeof(byte));
+  game->road_masks = arena_alloc(arena, game->grid_len * sizeof(byte));
+
+  for (int kind = 0; kind < NUM_KINDS; ++kind) {
+    Pool* pool = &game->pools[kind];
+    int cap = kind_cap(game, kind);
+    alloc_slots(&pool->slots, cap, arena);
+    pool->x = arena_alloc(arena, cap * sizeof(uint16_t));
+    pool->y = arena_alloc(arena, cap * sizeof(uint16_t));
+    pool->flags = arena_alloc(arena, cap * sizeof(byte));
+    pool->health = arena_alloc(arena, cap * sizeof(byte));
+  }
+  Bullets* bullets = &game->bullets;
+  bullets->x = arena_alloc(arena, game->max_bullets * sizeof(float));
+  bullets->y = arena_alloc(arena, game->max_bullets * sizeof(float));
+  bullets->prev_x = arena_alloc(arena, game->max_bullets * sizeof(float));
+  bullets->prev_y = arena_alloc(arena, game->max_bullets * sizeof(float));
+  bullets->dx = arena_alloc(arena, game->max_bullets * sizeof(float));
+  bullets->dy = arena_alloc(arena, game->max_bullets * sizeof(float));
+  bullets->flags = arena_alloc(arena, game->max_bullets * sizeof(byte));
+  bullets->is_out = arena_alloc(arena, (game->max_bullets + 7) / 8 * sizeof(byte));
+  int num_power_nodes = game->max_turrets + game->max_power_stones;
+  game->power_parent = arena_alloc(arena, num_power_nodes * sizeof(int));
+  game->power_size = arena_alloc(arena, num_power_nodes * sizeof(int));
+  game->power_has_stone = arena_alloc(arena, num_power_nodes * sizeof(bool));
+  game->power_queue = arena_alloc(arena, num_power_nodes * sizeof(int));
+  game->power_mark = arena_alloc(arena, num_power_nodes * sizeof(unsigned int));
+  game->beast_moves = arena_alloc(arena, game->max_beasts * sizeof(BeastMove));
+  game->turret_shots = arena_alloc(arena, game->max_turrets * sizeof(TurretShot));
+  game->workers.num = -1; // they're started by the first parallel_for()
+
+  game->bucket_counts = arena_alloc(arena, game->num_buckets_w * game->num_buckets_h * NUM_INDEXED_KINDS * sizeof(int));
+  game->flow_dist = arena_alloc(arena, game->grid_len * sizeof(byte));
+  game->flow_queue = arena_alloc(arena, game->grid_len * sizeof(int));
+  game->island_ids = arena_alloc(arena, game->grid_len * sizeof(int));
+  game->island_sizes = arena_alloc(arena, (game->grid_len + 1) / 2 * sizeof(int));
+  game->explored_stencil = arena_alloc(arena, (explored_dist * 2 + 1) * sizeof(int));
+  game->dirty_chunks = arena_alloc(arena, game->num_chunks_w * game->num_chunks_h * sizeof(bool));
+}
+
+void load(Game* game) {
+  game->num_collected_blocks = 250;
+  game->time = 0;
+  game->last_move_time = 0;
+  game->last_fire_time = 0;
+  game->last_mine_time = 0;
+  game->last_spawn_time = 0;
+  game->num_moves = 0;
+  game->num_spawns = 0;
+
+  game->terrain_rng = rng_stream(game->seed, RNG_TERRAIN, 0);
+  game->place_rng = rng_stream(game->seed, RNG_PLACEMENT, 0);
+
+  // have to manually init b/c C doesn't allow initializing VLAs w/ {0}
+  for (int i = 0; i < game->grid_len; ++i) {
+    game->grid[i] = NO_REF;
+    game->flow_dist[i] = FLOW_UNREACHED;
+    game->road_masks[i] = 0;
+  }
+  for (int i = 0; i < game->num_blocks_h * game->mask_w; ++i) {
+    game->roads[i] = 0;
+    game->explored[i] = 0;
+  }
+  game->flow_queue_len = 0;
+  game->is_flow_dirty = true;
+
+  for (int i = 0; i < game->num_buckets_w * game->num_buckets_h * NUM_INDEXED_KINDS; ++i)
+    game->bucket_counts[i] = 0;
+
+  for (int i = 0; i < game->num_chunks_w * game->num_chunks_h; ++i)
+    game->dirty_chunks[i] = true;
+  game->explored_dirty = empty_rect;
+
+  calc_explored_stencil(game->explored_stencil);
+
+  // free all entities/bullets (has to be before placing the starting fortress)
+  for (int kind = 0; kind < NUM_KINDS; ++kind) {
+    Pool* pool = &game->pools[kind];
+    slots_reset(&pool->slots);
+    for (int i = 0; i < pool->slots.cap; ++i)
+      pool->flags[i] = DELETED;
+  }
+
+  game->bullets.num = 0;
+  game->bullets.max_x = game->num_blocks_w * block_w;
+  game->bullets.max_y = game->num_blocks_h * block_h;
+
+  // the power nodes themselves are initialized as they're placed
+  for (int i = 0; i < game->max_turrets + game->max_power_stones; ++i)
+    game->power_mark[i] = 0;
+  game->power_gen = 0;
+  game->advance_bullets = pick_bullet_kernel(&game->bullet_kernel_name);
+
+  gen_water(game);
+  parallel_for(game, game->num_blocks_h, calc_coast_codes);
+
+  // the flow queue is free until the first update_flow()
+  game->num_islands = label_islands(game, game->flow_queue);
+
+  // start on the biggest of a few random islands
+  int max_size = 0;
+  int start_pos = -1;
+  for (int i = 0; i < 30; ++i) {
+    int pos = find_avail_pos(game);
+    int size = game->island_sizes[game->island_ids[pos]];
+    if (size > max_size) {
+      start_pos = pos;
+      max_size = size;
+    }
+  }
+
+  // build a starting fortress
+  game->start_pos = start_pos;
+  place_entity(game, to_x(game, start_pos), to_y(game, start_pos), BUILD_FORTRESS);
+
+  // add power stones to the playing field
+  for (int i = 0; i < game->max_power_stones; ++i) {
+    int pos = find_avail_pos(game);
+    set_pos(game, new_entity(game, KIND_STONE), pos);
+  }
+
+  for (int i = 0; i < game->grid_len * block_density_pct / 100; ++i) {
+    int pos = find_avail_pos(game);
+    set_pos(game, new_entity(game, KIND_BLOCK), pos);
+  }
+
+  Pool* beasts = &game->pools[KIND_BEAST];
+  for (int i = 0; i < num_starting_beasts; ++i) {
+    int pos = find_avail_pos(game);
+    Ref beast = new_entity(game, KIND_BEAST);
+    beasts->health[ref_slot(beast)] = beast_health;
+    set_pos(game, beast, pos);
+  }
+
+  Pool* nests = &game->pools[KIND_NEST];
+  for (int i = 0; i < game->max_nests; ++i) {
+    Ref nest = new_entity(game, KIND_NEST);
+    int pos = find_avail_pos(game);
+    nests->health[ref_slot(nest)] = nest_health;
+    set_pos(game, nest, pos);
+  }
+}
+
+// makes the water: a quadtree where each square gets a value that's its parent's plus a random amount
+// (clamped to a short), & the edge midpoints of each square w/ a negative value are water
+// the squares cover the smallest power-of-2 square around the map (bits outside the map are dropped)
+// works a row at a time into the water plane, so the rows can be done in parallel (a band of them per share),
+// & each square's random amount comes from hashing its position, so they don't depend on the order
+// then removes the 1-tile islands & lakes
+void gen_water(Game* game) {
+  parallel_for(game, game->num_shares, gen_water_bands);
+
+  parallel_for(game, game->num_blocks_h, remove_sm_islands);
+  uint64_t* tmp = game->water;
+  game->water = game->plane_scratch;
+  game->plane_scratch = tmp;
+
+  parallel_for(game, game->num_blocks_h, remove_sm_lakes);
+  tmp = game->water;
+  game->water = game->plane_scratch;
+  game->plane_scratch = tmp;
+}
+
+// makes bands start to end-1 of the water, where band n is the nth of num_shares even runs of rows
+// (parallel_for() gives each share one band, so each band gets its own slice of water_vals)
+void gen_water_bands(Game* game, int start, int end) {
+  for (int band = start; band < end; ++band)
+    gen_water_rows(game, &game->water_vals[band * (game->num_water_levels + 1) * game->num_blocks_w],
+      (int)((int64_t)game->num_blocks_h * band / game->num_shares), (int)((int64_t)game->num_blocks_h * (band + 1) / game->num_shares));
+}
+
+// vals is scratch for the values of the squares in the current row at each level, which only change
+// when the row crosses into the next row of squares at that level
+void gen_water_rows(Game* game, short vals[], int start, int end) {
+  int num_levels = game->num_water_levels;
+  for (int y = start; y < end; ++y) {
+    uint64_t* row = &game->water[y * game->mask_w];
+    for (int i = 0; i < game->mask_w; ++i)
+      row[i] = 0;
+
+    for (int level = num_levels; level >= 0; --level) {
+      int size = 1 << level;
+      int square_y = y >> level;
+      int num_squares = (game->num_blocks_w + size - 1) >> level;
+      short* level_vals = &vals[level * game->num_blocks_w];
+      short* parent_vals = &vals[(level + 1) * game->num_blocks_w];
+      if (y == start || (y & (size - 1)) == 0) {
+        // each hash gives the random amounts (signed shorts) for 4 squares
+        uint64_t bits = 0;
+        for (int square_x = 0; square_x < num_squares; ++square_x) {
+          if (square_x % 4 == 0) {
+            Rng rng = {.key = game->terrain_rng.key, .ctr = (uint64_t)level << 48 | (uint64_t)square_y << 24 | square_x / 4};
+            bits = rng_next(&rng);
+          }
+          int parent_val = level == num_levels ? 0 : parent_vals[square_x >> 1];
+          int deviation = (int)(bits & USHRT_MAX) - SHRT_MAX;
+          bits >>= 16;
+          level_vals[square_x] = clamp(parent_val + deviation, SHRT_MIN, SHRT_MAX);
+        }
+      }
+
+      // set the water for the square's top center, bottom center, left center & right center
+      // that are in this row (a 1x1 square's are all the tile itself)
+      // w/o branching on the values, since they're random & the branches would be mispredicted half the time
+      int row_in_square = y & (size - 1);
+      int offsets[3];
+      int num_offsets = 0;
+      if (row_in_square == 0 || row_in_square == size - 1)
+        offsets[num_offsets++] = size / 2;
+      if (row_in_square == size / 2 && size > 1) {
+        offsets[num_offsets++] = 0;
+        offsets[num_offsets++] = size - 1;
+      }
+      for (int i = 0; i < num_offsets; ++i) {
+        for (int square_x = 0; square_x < num_squares; ++square_x) {
+          int x = (square_x << level) + offsets[i];
+          uint64_t is_water = level_vals[square_x] < 0;
+          if (x < game->num_blocks_w)
+            row[x / 64] |= is_water << (x % 64);
+        }
+      }
+    }
+  }
+}
+
+// floods the land tiles w/ no land next to them (water into plane_scratch)
+void remove_sm_islands(Game* game, int start, int end) {
+  for (int y = start; y < end; ++y) {
+    for (int i = 0; i < game->mask_w; ++i) {
+      uint64_t land = mask_word(game, game->water, i, y, true);
+      uint64_t adj_land = adj_bits(game, game->water, i, y, true);
+      game->plane_scratch[y * game->mask_w + i] = game->water[y * game->mask_w + i] | (land & ~adj_land);
+    }
+  }
+}
+
+// drains the water tiles w/ no water next to them (water into plane_scratch)
+void remove_sm_lakes(Game* game, int start, int end) {
+  for (int y = start; y < end; ++y) {
+    for (int i = 0; i < game->mask_w; ++i) {
+      uint64_t water = mask_word(game, game->water, i, y, false);
+      uint64_t adj_water = adj_bits(game, game->water, i, y, false);
+      game->plane_scratch[y * game->mask_w + i] = water & adj_water;
+    }
+  }
+}
+
+// whether a tile's bit is set in a bit plane
+bool get_bit(Game* game, uint64_t plane[], int x, int y) {
+  return plane[y * game->mask_w + x / 64] >> (x % 64) & 1;
+}
+
+void set_bit(Game* game, uint64_t plane[], int x, int y) {
+  plane[y * game->mask_w + x / 64] |= 1ULL << (x % 64);
+}
+
+// the bits of the ith word of a row that are for columns x1 to x2
+uint64_t span_bits(int i, int x1, int x2) {
+  int first = clamp(x1 - i * 64, 0, 64);
+  int last = clamp(x2 - i * 64, -1, 63);
+  if (first > last)
+    return 0;
+  return (~0ULL >> (63 - last)) & (~0ULL << first);
+}
+
+// the ith 64 tiles of the row that are water (or land), w/ tiles off the map being neither
+uint64_t mask_word(Game* game, uint64_t mask[], int i, int y, bool is_land) {
+  if (i < 0 || i >= game->mask_w || y < 0 || y >= game->num_blocks_h)
+    return 0;
+
+  uint64_t word = mask[y * game->mask_w + i];
+  if (!is_land)
+    return word;
+
+  int num_valid = game->num_blocks_w - i * 64;
+  uint64_t valid = num_valid >= 64 ? ~0ULL : (1ULL << num_valid) - 1;
+  return ~word & valid;
+}
+
+// which of the ith 64 tiles of the row have water (or land) to their left/right/above/below
+uint64_t adj_bits(Game* game, uint64_t mask[], int i, int y, bool is_land) {
+  uint64_t word = mask_word(game, mask, i, y, is_land);
+  uint64_t left = word << 1 | mask_word(game, mask, i - 1, y, is_land) >> 63;
+  uint64_t right = word >> 1 | mask_word(game, mask, i + 1, y, is_land) << 63;
+  return left | right | mask_word(game, mask, i, y - 1, is_land) | mask_word(game, mask, i, y + 1, is_land);
+}
+
+// the ith 64 tiles of the row, shifted so each tile gets the bit of the tile dx (-1 to 1) to its right
+uint64_t shifted_word(Game* game, uint64_t mask[], int i, int y, int dx, bool is_land) {
+  uint64_t word = mask_word(game, mask, i, y, is_land);
+  if (dx < 0)
+    return word << 1 | mask_word(game, mask, i - 1, y, is_land) >> 63;
+  else if (dx > 0)
+    return word >> 1 | mask_word(game, mask, i + 1, y, is_land) << 63;
+  else
+    return word;
+}
+
+// works out how to draw each quarter of each tile along the coast, so rendering is just a lookup
+// (the terrain doesn't change after the map is generated, so this is only done once)
+// a land quarter is rounded off if there's water on both sides of its corner & a water quarter
+// is rounded in if there's land on both sides & diagonally (tiles off the map count as water)
+void calc_coast_codes(Game* game, int start, int end) {
+  for (int y = start; y < end; ++y) {
+    for (int i = 0; i < game->mask_w; ++i) {
+      uint64_t land = mask_word(game, game->water, i, y, true);
+      byte codes[64] = {0};
+      for (int corner = 0; corner < 4; ++corner) {
+        int dx = corner % 2 ? 1 : -1;
+        int adj_y = corner / 2 ? y + 1 : y - 1;
+        uint64_t side_land = shifted_word(game, game->water, i, y, dx, true);
+        uint64_t vert_land = mask_word(game, game->water, i, adj_y, true);
+        uint64_t diag_land = shifted_word(game, game->water, i, adj_y, dx, true);
+        uint64_t outer = land & ~side_land & ~vert_land;
+        uint64_t inner = ~land & side_land & vert_land & diag_land;
+        for (int bit = 0; bit < 64; ++bit) {
+          int code = land >> bit & 1 ? (outer >> bit & 1 ? COAST_OUTER : COAST_LAND) : (inner >> bit & 1 ? COAST_INNER : COAST_WATER);
+          codes[bit] |= code << (corner * 2);
+        }
+      }
+
+      int num_tiles = game->num_blocks_w - i * 64 < 64 ? game->num_blocks_w - i * 64 : 64;
+      for (int bit = 0; bit < num_tiles; ++bit)
+        game->coast_codes[y * game->num_blocks_w + i * 64 + bit] = codes[bit];
+    }
+  }
+}
+
+// gives each island (4-connected land) an id & counts its tiles, in two passes over the grid:
+// the first joins each land tile w/ the land to its left & above in a union-find forest,
+// the second numbers the trees in the order their roots come up
+// fills in island_ids & island_sizes; parent is scratch space for grid_len tiles
+// returns the number of islands
+int label_islands(Game* game, int parent[]) {
+  uint64_t* water = game->water;
+  int* island_ids = game->island_ids;
+  int* island_sizes = game->island_sizes;
+  for (int y = 0; y < game->num_blocks_h; ++y) {
+    for (int i = 0; i < game->mask_w; ++i) {
+      uint64_t land = mask_word(game, water, i, y, true);
+      uint64_t has_left_land = land & (land << 1 | mask_word(game, water, i - 1, y, true) >> 63);
+      uint64_t has_above_land = land & mask_word(game, water, i, y - 1, true);
+      for (; land; land &= land - 1) {
+        int bit = __builtin_ctzll(land);
+        int pos = y * game->num_blocks_w + i * 64 + bit;
+        parent[pos] = pos;
+        if (has_left_land >> bit & 1)
+          join_trees(parent, pos, pos - 1);
+        if (has_above_land >> bit & 1)
+          join_trees(parent, pos, pos - game->num_blocks_w);
+      }
+    }
+  }
+
+  // each root is the first tile of its island, so it's numbered before the rest of its tiles
+  int num_islands = 0;
+  for (int y = 0; y < game->num_blocks_h; ++y) {
+    for (int x = 0; x < game->num_blocks_w; ++x)
+      island_ids[y * game->num_blocks_w + x] = -1;
+
+    for (int i = 0; i < game->mask_w; ++i) {
+      for (uint64_t land = mask_word(game, water, i, y, true); land; land &= land - 1) {
+        int pos = y * game->num_blocks_w + i * 64 + __builtin_ctzll(land);
+        int root = find_root(parent, pos);
+        if (root == pos) {
+          island_ids[pos] = num_islands;
+          island_sizes[num_islands++] = 0;
+        }
+        else {
+          island_ids[pos] = island_ids[root];
+        }
+        island_sizes[island_ids[pos]]++;
+      }
+    }
+  }
+  return num_islands;
+}
+
+// merges the trees that a & b are in (the lower root becomes the parent)
+void join_trees(int parent[], int a, int b) {
+  a = find_root(parent, a);
+  b = find_root(parent, b);
+  if (a < b)
+    parent[b] = a;
+  else if (b < a)
+    parent[a] = b;
+}
+
+// halves the path to the root as it goes, so later lookups are shorter
+int find_root(int parent[], int i) {
+  while (parent[i] != i) {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+// try to place a road/fortress/bridge (build is one of the BUILD_* values)
+void place_entity(Game* game, int x, int y, int build) {
+  Ref* grid = game->grid;
+  int pos = to_pos(game, x, y);
+  bool is_water = get_bit(game, game->water, x, y);
+
+  bool is_refurb = false;
+  int num_required_blocks;
+  if (build == BUILD_ROAD) {
+    num_required_blocks = num_blocks_per_road;
+    if (is_water)
+      return; // can't build a road on water
+  }
+  else if (build == BUILD_FORTRESS) {
+    is_refurb = ref_kind(grid[pos]) == KIND_BLOCK;
+    num_required_blocks = is_refurb ? num_blocks_per_refurb : num_blocks_per_turret;
+    if (is_water)
+      return; // can't build a fortress on water
+  }
+  else if (build == BUILD_BRIDGE) {
+    num_required_blocks = num_blocks_per_bridge;
+    if (!is_water)
+      return; // can't build bridge on land
+  }
+  else {
+    sim_error("build is not road/fortress/bridge");
+  }
+
+  if ((grid[pos] && !is_refurb) || game->num_collected_blocks < num_required_blocks)
+    return;
+
+  if (build == BUILD_FORTRESS) {
+
+    // if there's nothing adjacent, disallow if there are existing fortress
+    Pool* turrets = &game->pools[KIND_TURRET];
+    if (!is_adj(game, x, y) && turrets->slots.num_live)
+      return;
+
+    // TODO: alert the player if game->max_turrets has been reached
+    Ref turret = new_entity(game, KIND_TURRET);
+    if (!turret)
+      return;
+
+    if (is_refurb)
+      del_entity(game, grid[pos]);
+
+    game->num_collected_blocks -= num_required_blocks;
+    turrets->health[ref_slot(turret)] = fortress_health;
+    set_xy(game, turret, x, y);
+    update_explored(game, pos);
+  }
+  else {
+    // abort if there's already a road here or if there's nothing adjacent
+    if (get_bit(game, game->roads, x, y))
+      return;
+    if (!is_adj(game, x, y))
+      return;
+
+    game->num_collected_blocks -= num_required_blocks;
+    set_bit(game, game->roads, x, y);
+    connect_road(game, x, y);
+    mark_dirty(game, x, y);
+    update_explored(game, pos);
+  }
+}
+
+// links a new road w/ the roads next to it in road_masks, so drawing it (& them) is just a lookup
+void connect_road(Game* game, int x, int y) {
+  int pos = to_pos(game, x, y);
+  byte mask = 0;
+  if (is_adj_above(game, x, y, true)) {
+    mask |= ROAD_ABOVE;
+    game->road_masks[pos - game->num_blocks_w] |= ROAD_BELOW;
+  }
+  if (is_adj_below(game, x, y, true)) {
+    mask |= ROAD_BELOW;
+    game->road_masks[pos + game->num_blocks_w] |= ROAD_ABOVE;
+  }
+  if (is_adj_left(game, x, y, true)) {
+    mask |= ROAD_LEFT;
+    game->road_masks[pos - 1] |= ROAD_RIGHT;
+  }
+  if (is_adj_right(game, x, y, true)) {
+    mask |= ROAD_RIGHT;
+    game->road_masks[pos + 1] |= ROAD_LEFT;
+  }
+  game->road_masks[pos] = mask;
+}
+
+// marks the tiles within explored_dist of pos as explored
+// returns how many were newly explored (they're also added to explored_dirty)
+int update_explored(Game* game, int pos) {
+  int x = to_x(game, pos);
+  int y = to_y(game, pos);
+  int num_explored = 0;
+
+  // walk the disk stencil, clipped to the grid, a word of each row at a time
+  int y1 = clamp(y - explored_dist, 0, game->num_blocks_h - 1);
+  int y2 = clamp(y + explored_dist, 0, game->num_blocks_h - 1);
+  for (int row_y = y1; row_y <= y2; ++row_y) {
+    int half_w = game->explored_stencil[row_y - y + explored_dist];
+    if (half_w < 0)
+      continue;
+
+    int x1 = clamp(x - half_w, 0, game->num_blocks_w - 1);
+    int x2 = clamp(x + half_w, 0, game->num_blocks_w - 1);
+    for (int i = x1 / 64; i <= x2 / 64; ++i) {
+      uint64_t* word = &game->explored[row_y * game->mask_w + i];
+      uint64_t new_bits = span_bits(i, x1, x2) & ~*word;
+      if (!new_bits)
+        continue;
+
+      *word |= new_bits;
+      extend_rect(&game->explored_dirty, i * 64 + __builtin_ctzll(new_bits), row_y);
+      extend_rect(&game->explored_dirty, i * 64 + 63 - __builtin_clzll(new_bits), row_y);
+      num_explored += __builtin_popcountll(new_bits);
+    }
+  }
+  return num_explored;
+}
+
+// for each row of the disk of tiles closer than explored_dist to its center,
+// stores how far it extends to the left/right (or -1 if the row is empty)
+// the stencil needs explored_dist * 2 + 1 rows
+void calc_explored_stencil(int stencil[]) {
+  for (int dy = -explored_dist; dy <= explored_dist; ++dy) {
+    int half_w = -1;
+    while (calc_dist(0, 0, half_w + 1, dy) < explored_dist)
+      half_w++;
+    stencil[dy + explored_dist] = half_w;
+  }
+}
+
+// advances the game by dt seconds (normally tick_dt, so results don't depend on frame rate)
+// the phases are separate functions so they can be timed individually (see bench.c)
+void step(Game* game, double dt) {
+  step_with_hook(game, dt, NULL);
+}
+
+// step(), calling on_phase (if it's not NULL) after each phase
+void step_with_hook(Game* game, double dt, PhaseHook on_phase) {
+  game->time += dt * 1000.0;
+
+  for (int i = 0; i < NUM_STEP_PHASES; ++i) {
+    step_phases[i].fn(game, dt);
+    if (on_phase)
+      on_phase(game, i);
+  }
+}
+
+// each turret mines a block every mine_interval
+void mine_blocks(Game* game, double dt) {
+  (void)dt;
+  if (game->time - game->last_mine_time < mine_interval)
+    return;
+
+  game->num_collected_blocks += game->pools[KIND_TURRET].slots.num_live;
+  game->last_mine_time = game->time;
+}
+
+// each turret fires at the closest beast/nest in range every turret_fire_interval
+// the targets are found in parallel, then the bullets are fired in live-list order
+void fire_turrets(Game* game, double dt) {
+  (void)dt;
+  if (game->time - game->last_fire_time < turret_fire_interval)
+    return;
+
+  Pool* turrets = &game->pools[KIND_TURRET];
+  Bullets* bullets = &game->bullets;
+  parallel_for(game, turrets->slots.num_live, aim_turrets);
+
+  for (int j = 0; j < turrets->slots.num_live; ++j) {
+    TurretShot* shot = &game->turret_shots[j];
+    if (!shot->target)
+      continue; // nothing within fortress_attack_dist
+
+    // TODO: determine when game->max_bullets is exceeded & notify player?
+    if (bullets->num == game->max_bullets)
+      break;
+
+    int i = turrets->slots.live[j];
+    int b = bullets->num++;
+    double dx = shot->dx;
+    double dy = shot->dy;
+
+    // super turrets make super bullets
+    bullets->flags[b] = is_powered(game, to_ref(KIND_TURRET, i)) ? POWER : 0;
+
+    // start in top/left corner
+    int start_x = turrets->x[i] * block_w;
+    int start_y = turrets->y[i] * block_h;
+    if (dx > 0)
+      start_x += block_w;
+    else if (dx == 0)
+      start_x += block_w / 2;
+    else
+      start_x -= 1; // so it's not on top of itself
+
+    if (dy > 0)
+      start_y += block_h;
+    else if (dy == 0)
+      start_y += block_h / 2;
+    else
+      start_y -= 1; // so it's not on top of itself
+
+    bullets->x[b] = start_x;
+    bullets->y[b] = start_y;
+    bullets->prev_x[b] = start_x;
+    bullets->prev_y[b] = start_y;
+    bullets->dx[b] = dx;
+    bullets->dy[b] = dy;
+  }
+  game->last_fire_time = game->time;
+}
+
+// fills in turret_shots for the turrets from start to end-1 in the live list
+// only reads the game, so it's safe to run on several threads at once
+void aim_turrets(Game* game, int start, int end) {
+  Pool* turrets = &game->pools[KIND_TURRET];
+  Pool* beasts = &game->pools[KIND_BEAST];
+  Pool* nests = &game->pools[KIND_NEST];
+  for (int j = start; j < end; ++j) {
+    int i = turrets->slots.live[j];
+    int turret_x = turrets->x[i];
+    int turret_y = turrets->y[i];
+    TurretShot* shot = &game->turret_shots[j];
+
+    Ref beast = closest_entity(game, turret_x, turret_y, KIND_BEAST, fortress_attack_dist);
+    double beast_dist = -1;
+    if (beast)
+      beast_dist = calc_dist(beasts->x[ref_slot(beast)], beasts->y[ref_slot(beast)], turret_x, turret_y);
+
+    Ref nest = closest_entity(game, turret_x, turret_y, KIND_NEST, fortress_attack_dist);
+    double nest_dist = -1;
+    if (nest)
+      nest_dist = calc_dist(nests->x[ref_slot(nest)], nests->y[ref_slot(nest)], turret_x, turret_y);
+
+    double dist;
+    if (beast && nest) {
+      if (beast_dist < nest_dist) {
+        shot->target = beast;
+        dist = beast_dist;
+      }
+      else {
+        shot->target = nest;
+        dist = nest_dist;
+      }
+    }
+    else if (beast) {
+      shot->target = beast;
+      dist = beast_dist;
+    }
+    else if (nest) {
+      shot->target = nest;
+      dist = nest_dist;
+    }
+    else {
+      shot->target = NO_REF;
+      continue;
+    }
+
+    // dividing by the distance gives us a normalized 1-unit vector
+    Pool* enemies = ref_pool(game, shot->target);
+    shot->dx = (enemies->x[ref_slot(shot->target)] - turret_x) / dist;
+    shot->dy = (enemies->y[ref_slot(shot->target)] - turret_y) / dist;
+  }
+}
+
+// each nest spawns a beast next to it every beast_spawn_interval
+void spawn_beasts(Game* game, double dt) {
+  (void)dt;
+  if (game->time - game->last_spawn_time < beast_spawn_interval)
+    return;
+
+  Pool* nests = &game->pools[KIND_NEST];
+  Pool* beasts = &game->pools[KIND_BEAST];
+  for (int j = 0; j < nests->slots.num_live; ++j) {
+    int i = nests->slots.live[j];
+    Rng rng = entity_rng(game, RNG_NESTS, i, game->num_spawns);
+    int spawn_pos = choose_adj_pos(game, to_ref(KIND_NEST, i), &rng);
+    if (spawn_pos == -1)
+      continue;
+
+    Ref beast = new_entity(game, KIND_BEAST);
+    if (!beast)
+      continue;
+
+    beasts->health[ref_slot(beast)] = beast_health;
+    set_pos(game, beast, spawn_pos);
+  }
+  game->num_spawns++;
+  game->last_spawn_time = game->time;
+}
+
+// every beast_move_interval, each beast attacks/moves/explodes
+// first every beast decides what to do, in parallel, based on the grid as it is before anyone moves
+// then the moves are carried out in live-list order, so if two beasts want the same tile,
+// the first one gets it & the other stays put
+void move_beasts(Game* game, double dt) {
+  (void)dt;
+  if (game->time - game->last_move_time < beast_move_interval)
+    return;
+
+  if (game->is_flow_dirty)
+    update_flow(game);
+
+  int num_beasts = game->pools[KIND_BEAST].slots.num_live;
+  parallel_for(game, num_beasts, plan_beast_moves);
+
+  Pool* turrets = &game->pools[KIND_TURRET];
+  for (int i = 0; i < num_beasts; ++i) {
+    BeastMove* m = &game->beast_moves[i];
+
+    // an earlier beast may have already destroyed the turret
+    if (m->turret && !(turrets->flags[ref_slot(m->turret)] & DELETED))
+      inflict_damage(game, m->turret);
+
+    if (m->dest_pos == -1)
+      beast_explode(game, m->beast);
+    else if (!game->grid[m->dest_pos])
+      move(game, m->beast, to_x(game, m->dest_pos), to_y(game, m->dest_pos));
+  }
+  game->num_moves++;
+  game->last_move_time = game->time;
+}
+
+// fills in beast_moves for the beasts from start to end-1 in the live list
+// only reads the game, so it's safe to run on several threads at once
+void plan_beast_moves(Game* game, int start, int end) {
+  Pool* beasts = &game->pools[KIND_BEAST];
+  for (int j = start; j < end; ++j) {
+    int i = beasts->slots.live[j];
+    Ref beast = to_ref(KIND_BEAST, i);
+    BeastMove* m = &game->beast_moves[j];
+    m->beast = beast;
+    m->turret = NO_REF;
+    m->dest_pos = -1;
+
+    // each beast gets its own stream, so its choices don't depend on the others
+    Rng rng = entity_rng(game, RNG_BEASTS, i, game->num_moves);
+    if (is_next_to_wall(game, beast)) {
+      if (beasts->flags[i] & POWER || rng_int(&rng, 100) >= 98)
+        continue; // blow up
+    }
+
+    // if we're already next to a turret, attack it & then mill about
+    // otherwise follow the flow field towards the nearest turret (if there's one in range)
+    // a quarter of the time we want them to move randomly anyway,
+    // which keeps them from being too deterministic
+    m->turret = adj_turret(game, beast);
+    if (!m->turret && rng_int(&rng, 100) <= 75)
+      m->dest_pos = flow_step(game, beast);
+
+    // if the beast is surrounded by blocks & has nowhere to move, it blows up
+    if (m->dest_pos == -1)
+      m->dest_pos = choose_adj_pos(game, beast, &rng);
+  }
+}
+
+// moves the bullets dt seconds further & handles their collisions
+// the moving is done by a SIMD kernel, then each bullet's path is traced through the grid,
+// so it hits whatever it passed over no matter how long dt is
+void move_bullets(Game* game, double dt) {
+  Bullets* bullets = &game->bullets;
+  game->advance_bullets(bullets, bullet_speed * dt);
+
+  // backwards, so deleting a bullet only moves an already-handled one into its place
+  for (int i = bullets->num - 1; i >= 0; --i) {
+    Ref ref = trace_bullet(game, bullets->prev_x[i], bullets->prev_y[i], bullets->x[i], bullets->y[i]);
+    if (ref) {
+      if (is_enemy_kind(ref_kind(ref)))
+        inflict_damage(game, ref);
+      del_bullet(game, i);
+    }
+    else if (bullets->is_out[i / 8] & (1 << (i % 8))) {
+      del_bullet(game, i); // it's gone off the map
+    }
+  }
+}
+
+// the SIMD kernels give exactly the same results as the scalar one (they don't use FMA),
+// so which one runs doesn't affect the game
+BulletKernel pick_bullet_kernel(char** name) {
+#ifdef HAS_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx")) {
+    *name = "avx";
+    return advance_bullets_avx;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    *name = "sse2";
+    return advance_bullets_sse2;
+  }
+#endif
+  *name = "scalar";
+  return advance_bullets_scalar;
+}
+
+void advance_bullets_scalar(Bullets* bullets, float step) {
+  advance_bullet_range(bullets, 0, step);
+}
+
+// start has to be a multiple of 8, since each byte of is_out covers 8 bullets
+void advance_bullet_range(Bullets* bullets, int start, float step) {
+  float max_x = bullets->max_x;
+  float max_y = bullets->max_y;
+  for (int i = start; i < bullets->num; ++i) {
+    bullets->prev_x[i] = bullets->x[i];
+    bullets->prev_y[i] = bullets->y[i];
+    bullets->x[i] += bullets->dx[i] * step;
+    bullets->y[i] += bullets->dy[i] * step;
+
+    if (i % 8 == 0)
+      bullets->is_out[i / 8] = 0;
+    if (bullets->x[i] < 0 || bullets->x[i] > max_x || bullets->y[i] < 0 || bullets->y[i] > max_y)
+      bullets->is_out[i / 8] |= 1 << (i % 8);
+  }
+}
+
+#ifdef HAS_X86_KERNELS
+__attribute__((target("avx")))
+void advance_bullets_avx(Bullets* bullets, float step) {
+  __m256 step8 = _mm256_set1_ps(step);
+  __m256 zero = _mm256_setzero_ps();
+  __m256 max_x = _mm256_set1_ps(bullets->max_x);
+  __m256 max_y = _mm256_set1_ps(bullets->max_y);
+
+  int i = 0;
+  for (; i + 8 <= bullets->num; i += 8) {
+    __m256 x = _mm256_loadu_ps(bullets->x + i);
+    __m256 y = _mm256_loadu_ps(bullets->y + i);
+    _mm256_storeu_ps(bullets->prev_x + i, x);
+    _mm256_storeu_ps(bullets->prev_y + i, y);
+    x = _mm256_add_ps(x, _mm256_mul_ps(_mm256_loadu_ps(bullets->dx + i), step8));
+    y = _mm256_add_ps(y, _mm256_mul_ps(_mm256_loadu_ps(bullets->dy + i), step8));
+    _mm256_storeu_ps(bullets->x + i, x);
+    _mm256_storeu_ps(bullets->y + i, y);
+
+    __m256 out_x = _mm256_or_ps(_mm256_cmp_ps(x, zero, _CMP_LT_OQ), _mm256_cmp_ps(x, max_x, _CMP_GT_OQ));
+    __m256 out_y = _mm256_or_ps(_mm256_cmp_ps(y, zero, _CMP_LT_OQ), _mm256_cmp_ps(y, max_y, _CMP_GT_OQ));
+    bullets->is_out[i / 8] = _mm256_movemask_ps(_mm256_or_ps(out_x, out_y));
+  }
+  advance_bullet_range(bullets, i, step);
+}
+
+__attribute__((target("sse2")))
+void advance_bullets_sse2(Bullets* bullets, float step) {
+  __m128 step4 = _mm_set1_ps(step);
+  __m128 zero = _mm_setzero_ps();
+  __m128 max_x = _mm_set1_ps(bullets->max_x);
+  __m128 max_y = _mm_set1_ps(bullets->max_y);
+
+  int i = 0;
+  for (; i + 8 <= bullets->num; i += 8) {
+    int mask = 0;
+    for (int half = 0; half < 2; ++half) {
+      int j = i + half * 4;
+      __m128 x = _mm_loadu_ps(bullets->x + j);
+      __m128 y = _mm_loadu_ps(bullets->y + j);
+      _mm_storeu_ps(bullets->prev_x + j, x);
+      _mm_storeu_ps(bullets->prev_y + j, y);
+      x = _mm_add_ps(x, _mm_mul_ps(_mm_loadu_ps(bullets->dx + j), step4));
+      y = _mm_add_ps(y, _mm_mul_ps(_mm_loadu_ps(bullets->dy + j), step4));
+      _mm_storeu_ps(bullets->x + j, x);
+      _mm_storeu_ps(bullets->y + j, y);
+
+      __m128 out_x = _mm_or_ps(_mm_cmplt_ps(x, zero), _mm_cmpgt_ps(x, max_x));
+      __m128 out_y = _mm_or_ps(_mm_cmplt_ps(y, zero), _mm_cmpgt_ps(y, max_y));
+      mask |= _mm_movemask_ps(_mm_or_ps(out_x, out_y)) << (half * 4);
+    }
+    bullets->is_out[i / 8] = mask;
+  }
+  advance_bullet_range(bullets, i, step);
+}
+#endif
+
+
+// Grid Functions
+
+int find_avail_pos(Game* game) {
+  int x;
+  int y;
+  int pos;
+  do {
+    x = rng_int(&game->place_rng, game->num_blocks_w);
+    y = rng_int(&game->place_rng, game->num_blocks_h);
+    pos = to_pos(game, x, y);
+  } while (game->grid[pos] || get_bit(game, game->water, x, y));
+  return pos;
+}
+
+void move(Game* game, Ref ref, int x, int y) {
+  remove_from_grid(game, ref);
+  set_xy(game, ref, x, y);
+}
+
+void set_pos(Game* game, Ref ref, int pos) {
+  set_xy(game, ref, to_x(game, pos), to_y(game, pos));
+}
+
+void set_xy(Game* game, Ref ref, int x, int y) {
+  Pool* pool = ref_pool(game, ref);
+  pool->x[ref_slot(ref)] = x;
+  pool->y[ref_slot(ref)] = y;
+  game->grid[to_pos(game, x, y)] = ref;
+
+  // turrets & blocks change where beasts can go
+  int kind = ref_kind(ref);
+  if (is_block_kind(kind))
+    game->is_flow_dirty = true;
+
+  if (kind < NUM_INDEXED_KINDS)
+    game->bucket_counts[to_bucket(game, x, y) * NUM_INDEXED_KINDS + kind]++;
+
+  if (kind == KIND_TURRET || kind == KIND_STONE)
+    join_power(game, to_pos(game, x, y));
+}
+
+void remove_from_grid(Game* game, Ref ref) {
+  Pool* pool = ref_pool(game, ref);
+  int x = pool->x[ref_slot(ref)];
+  int y = pool->y[ref_slot(ref)];
+  int prev_pos = to_pos(game, x, y);
+  if (game->grid[prev_pos] != ref)
+    return;
+
+  game->grid[prev_pos] = NO_REF;
+
+  int kind = ref_kind(ref);
+  if (is_block_kind(kind))
+    game->is_flow_dirty = true;
+
+  if (kind < NUM_INDEXED_KINDS)
+    game->bucket_counts[to_bucket(game, x, y) * NUM_INDEXED_KINDS + kind]--;
+
+  if (kind == KIND_TURRET || kind == KIND_STONE)
+    split_power(game, prev_pos);
+}
+
+int to_x(Game* game, int ix) {
+  return ix % game->num_blocks_w;
+}
+
+int to_y(Game* game, int ix) {
+  return ix / game->num_blocks_w;
+}
+
+int to_pos(Game* game, int x, int y) {
+  int pos = x + y * game->num_blocks_w;
+  if (pos < 0)
+    sim_error("position out of bounds (negative)");
+  if (pos >= game->grid_len)
+    sim_error("position out of bounds (greater than grid size)");
+  return pos;
+}
+
+bool is_in_grid(Game* game, int x, int y) {
+  if ((x < 0 || x >= game->num_blocks_w) ||
+    (y < 0 || y >= game->num_blocks_h))
+      return false;
+
+  return true;
+}
+
+int to_bucket(Game* game, int x, int y) {
+  return x / bucket_size + (y / bucket_size) * game->num_buckets_w;
+}
+
+
+// Entity Functions
+
+// how many slots the pool for a KIND_* has
+int kind_cap(Game* game, int kind) {
+  if (kind == KIND_BEAST)
+    return game->max_beasts;
+  else if (kind == KIND_NEST)
+    return game->max_nests;
+  else if (kind == KIND_TURRET)
+    return game->max_turrets;
+  else if (kind == KIND_BLOCK)
+    return game->max_blocks;
+  else
+    return game->max_power_stones;
+}
+
+// takes a free slot from the kind's pool (NO_REF if they're all in use)
+// the caller sets its health & position
+Ref new_entity(Game* game, int kind) {
+  Pool* pool = &game->pools[kind];
+  int slot = slots_take(&pool->slots);
+  if (slot == -1)
+    return NO_REF;
+
+  pool->flags[slot] = 0;
+  return to_ref(kind, slot);
+}
+
+// the kind is stored +1 so that no entity has a ref of 0 (NO_REF)
+Ref to_ref(int kind, int slot) {
+  return (Ref)(((kind + 1) << SLOT_BITS) | slot);
+}
+
+// the entity's KIND_* (-1 for NO_REF)
+int ref_kind(Ref ref) {
+  return (ref >> SLOT_BITS) - 1;
+}
+
+int ref_slot(Ref ref) {
+  return ref & SLOT_MASK;
+}
+
+Pool* ref_pool(Game* game, Ref ref) {
+  return &game->pools[ref_kind(ref)];
+}
+
+// turrets, blocks & power stones: things that block beasts & bullets
+bool is_block_kind(int kind) {
+  return kind == KIND_TURRET || kind == KIND_BLOCK || kind == KIND_STONE;
+}
+
+// beasts & nests: things that turrets shoot at
+bool is_enemy_kind(int kind) {
+  return kind == KIND_BEAST || kind == KIND_NEST;
+}
+
+
+// Game-Specific Functions
+
+bool is_next_to_wall(Game* game, Ref beast) {
+  Pool* beasts = &game->pools[KIND_BEAST];
+  for (int dir_x = -1; dir_x <= 1; ++dir_x) {
+    for (int dir_y = -1; dir_y <= 1; ++dir_y) {
+      // check the bounds
+      int new_x = beasts->x[ref_slot(beast)] + dir_x;
+      int new_y = beasts->y[ref_slot(beast)] + dir_y;
+      if (!is_in_grid(game, new_x, new_y))
+        continue;
+
+      if (is_powered(game, game->grid[to_pos(game, new_x, new_y)]))
+        return true;
+    }
+  }
+  return false;
+}
+
+bool is_adj(Game* game, int x, int y) {
+  return is_adj_left(game, x, y, false) ||
+    is_adj_right(game, x, y, false) ||
+    is_adj_above(game, x, y, false) ||
+    is_adj_below(game, x, y, false);
+}
+
+bool is_adj_left(Game* game, int x, int y, bool road_only) {
+  if (x > 0) {
+    int left_pos = to_pos(game, x - 1, y);
+    if (get_bit(game, game->roads, x - 1, y))
+      return true;
+    if (!road_only && ref_kind(game->grid[left_pos]) == KIND_TURRET)
+      return true;
+  }
+  return false;
+}
+
+bool is_adj_right(Game* game, int x, int y, bool road_only) {
+  if (x < game->num_blocks_w - 1) {
+    int right_pos = to_pos(game, x + 1, y);
+    if (get_bit(game, game->roads, x + 1, y))
+      return true;
+    if (!road_only && ref_kind(game->grid[right_pos]) == KIND_TURRET)
+      return true;
+  }
+  return false;
+}
+
+bool is_adj_above(Game* game, int x, int y, bool road_only) {
+  if (y > 0) {
+    int above_pos = to_pos(game, x, y - 1);
+    if (get_bit(game, game->roads, x, y - 1))
+      return true;
+    if (!road_only && ref_kind(game->grid[above_pos]) == KIND_TURRET)
+      return true;
+  }
+  return false;
+}
+
+bool is_adj_below(Game* game, int x, int y, bool road_only) {
+  if (y < game->num_blocks_h - 1) {
+    int below_pos = to_pos(game, x, y + 1);
+    if (get_bit(game, game->roads, x, y + 1))
+      return true;
+    if (!road_only && ref_kind(game->grid[below_pos]) == KIND_TURRET)
+      return true;
+  }
+  return false;
+}
+
+void beast_explode(Game* game, Ref beast) {
+  Pool* beasts = &game->pools[KIND_BEAST];
+  int x = beasts->x[ref_slot(beast)];
+  int y = beasts->y[ref_slot(beast)];
+
+  if (!(beasts->flags[ref_slot(beast)] & POWER))
+    del_entity(game, beast);
+
+  for (int dir_x = -1; dir_x <= 1; ++dir_x) {
+    for (int dir_y = -1; dir_y <= 1; ++dir_y) {
+      // check the bounds
+      int new_x = x + dir_x;
+      int new_y = y + dir_y;
+      if (!is_in_grid(game, new_x, new_y))
+        continue;
+
+      Ref ref = game->grid[to_pos(game, new_x, new_y)];
+      int kind = ref_kind(ref);
+      if (kind == KIND_TURRET || kind == KIND_BLOCK)
+        del_entity(game, ref);
+    }
+  }
+}
+
+// finds the closest live entity of the given KIND_* that is within max_dist
+// searches the spatial index outwards, one ring of buckets at a time,
+// skipping buckets that have none of that kind or are too far away to win
+// ties go to the entity w/ the lowest ref (i.e. the first in its pool)
+Ref closest_entity(Game* game, int x, int y, int kind, int max_dist) {
+  Ref winner = NO_REF;
+  int winner_dist_sq = max_dist * max_dist + 1;
+
+  int center_x = x / bucket_size;
+  int center_y = y / bucket_size;
+  int max_ring = game->num_buckets_w > game->num_buckets_h ? game->num_buckets_w : game->num_buckets_h;
+  for (int ring = 0; ring < max_ring; ++ring) {
+    // every tile in this ring is at least this far away
+    int min_dist = ring ? (ring - 1) * bucket_size + 1 : 0;
+    if (min_dist * min_dist > winner_dist_sq)
+      break;
+
+    for (int bucket_y = center_y - ring; bucket_y <= center_y + ring; ++bucket_y) {
+      if (bucket_y < 0 || bucket_y >= game->num_buckets_h)
+        continue;
+
+      // only the first & last rows of the ring are full, the rest are just the two ends
+      bool is_edge_row = bucket_y == center_y - ring || bucket_y == center_y + ring;
+      int step_x = (is_edge_row || !ring) ? 1 : ring * 2;
+      for (int bucket_x = center_x - ring; bucket_x <= center_x + ring; bucket_x += step_x) {
+        if (bucket_x < 0 || bucket_x >= game->num_buckets_w)
+          continue;
+        if (!game->bucket_counts[(bucket_x + bucket_y * game->num_buckets_w) * NUM_INDEXED_KINDS + kind])
+          continue;
+
+        int x1 = bucket_x * bucket_size;
+        int y1 = bucket_y * bucket_size;
+        int x2 = clamp(x1 + bucket_size, 0, game->num_blocks_w) - 1;
+        int y2 = clamp(y1 + bucket_size, 0, game->num_blocks_h) - 1;
+
+        // skip the bucket if even its nearest tile can't beat the current winner
+        int dx = x < x1 ? x1 - x : (x > x2 ? x - x2 : 0);
+        int dy = y < y1 ? y1 - y : (y > y2 ? y - y2 : 0);
+        if (dx * dx + dy * dy > winner_dist_sq)
+          continue;
+
+        for (int tile_y = y1; tile_y <= y2; ++tile_y) {
+          for (int tile_x = x1; tile_x <= x2; ++tile_x) {
+            Ref ref = game->grid[to_pos(game, tile_x, tile_y)];
+            if (ref_kind(ref) != kind)
+              continue;
+
+            int dist_sq = (tile_x - x) * (tile_x - x) + (tile_y - y) * (tile_y - y);
+            if (dist_sq < winner_dist_sq || (dist_sq == winner_dist_sq && winner && ref < winner)) {
+              winner = ref;
+              winner_dist_sq = dist_sq;
+            }
+          }
+        }
+      }
+    }
+  }
+  return winner;
+}
+
+// the first entity a bullet going from x1,y1 to x2,y2 (in px) runs into (NO_REF if none)
+// visits every tile on the path in order, starting w/ the one it starts in (Amanatides & Woo's DDA)
+Ref trace_bullet(Game* game, double x1, double y1, double x2, double y2) {
+  int tile_x = floor(x1 / block_w);
+  int tile_y = floor(y1 / block_h);
+  int end_x = floor(x2 / block_w);
+  int end_y = floor(y2 / block_h);
+  int num_steps = abs(end_x - tile_x) + abs(end_y - tile_y);
+
+  // how far along the path (from 0 to 1) the next vertical & horizontal tile edges are,
+  // & how far it is between edges
+  double dx = x2 - x1;
+  double dy = y2 - y1;
+  int step_x = dx > 0 ? 1 : -1;
+  int step_y = dy > 0 ? 1 : -1;
+  double next_x = dx ? ((tile_x + (dx > 0)) * block_w - x1) / dx : INFINITY;
+  double next_y = dy ? ((tile_y + (dy > 0)) * block_h - y1) / dy : INFINITY;
+  double delta_x = dx ? block_w / fabs(dx) : INFINITY;
+  double delta_y = dy ? block_h / fabs(dy) : INFINITY;
+
+  for (int i = 0; ; ++i) {
+    // once it's off the map it's not coming back (a straight line can't re-enter a rectangle)
+    if (!is_in_grid(game, tile_x, tile_y))
+      return NO_REF;
+
+    Ref ref = game->grid[to_pos(game, tile_x, tile_y)];
+    if (ref)
+      return ref;
+    if (i == num_steps)
+      return NO_REF;
+
+    // step to whichever edge is crossed first (w/o overshooting the end tile)
+    if ((next_x < next_y && tile_x != end_x) || tile_y == end_y) {
+      tile_x += step_x;
+      next_x += delta_x;
+    }
+    else {
+      tile_y += step_y;
+      next_y += delta_y;
+    }
+  }
+}
+
+// moves the last bullet into its place (its is_out bit isn't moved w/ it)
+void del_bullet(Game* game, int i) {
+  Bullets* bullets = &game->bullets;
+  int last = --bullets->num;
+  bullets->x[i] = bullets->x[last];
+  bullets->y[i] = bullets->y[last];
+  bullets->prev_x[i] = bullets->prev_x[last];
+  bullets->prev_y[i] = bullets->prev_y[last];
+  bullets->dx[i] = bullets->dx[last];
+  bullets->dy[i] = bullets->dy[last];
+  bullets->flags[i] = bullets->flags[last];
+}
+
+void del_entity(Game* game, Ref ref) {
+  Pool* pool = ref_pool(game, ref);
+  int slot = ref_slot(ref);
+  pool->flags[slot] |= DELETED; // flip DELETED bit on
+  slots_free(&pool->slots, slot);
+  remove_from_grid(game, ref);
+
+  // blocks & stones are part of the terrain chunks (turrets are drawn separately)
+  int kind = ref_kind(ref);
+  if (kind == KIND_BLOCK || kind == KIND_STONE)
+    mark_dirty(game, pool->x[slot], pool->y[slot]);
+}
+
+// flags the terrain chunks around a tile for redrawing
+// neighbouring tiles are included b/c road & coastline sprites depend on them
+void mark_dirty(Game* game, int x, int y) {
+  int chunk_x1 = clamp(x - 1, 0, game->num_blocks_w - 1) / chunk_size;
+  int chunk_y1 = clamp(y - 1, 0, game->num_blocks_h - 1) / chunk_size;
+  int chunk_x2 = clamp(x + 1, 0, game->num_blocks_w - 1) / chunk_size;
+  int chunk_y2 = clamp(y + 1, 0, game->num_blocks_h - 1) / chunk_size;
+  for (int chunk_y = chunk_y1; chunk_y <= chunk_y2; ++chunk_y)
+    for (int chunk_x = chunk_x1; chunk_x <= chunk_x2; ++chunk_x)
+      game->dirty_chunks[chunk_x + chunk_y * game->num_chunks_w] = true;
+}
+
+// the power node of a turret/stone (-1 for anything else)
+int power_node(Game* game, Ref ref) {
+  int kind = ref_kind(ref);
+  if (kind == KIND_TURRET)
+    return ref_slot(ref);
+  else if (kind == KIND_STONE)
+    return game->max_turrets + ref_slot(ref);
+  else
+    return -1;
+}
+
+int power_node_pos(Game* game, int node) {
+  Pool* pool = &game->pools[node < game->max_turrets ? KIND_TURRET : KIND_STONE];
+  int slot = node < game->max_turrets ? node : node - game->max_turrets;
+  return to_pos(game, pool->x[slot], pool->y[slot]);
+}
+
+// whether the entity is a turret/stone that's connected to a stone
+// doesn't change the forest, so the parallel phases can call it
+// (the trees are joined by size, so they're only O(log n) deep)
+bool is_powered(Game* game, Ref ref) {
+  int node = power_node(game, ref);
+  if (node == -1)
+    return false;
+
+  while (game->power_parent[node] != node)
+    node = game->power_parent[node];
+  return game->power_has_stone[node];
+}
+
+// adds the newly placed turret/stone on the tile to the network
+void join_power(Game* game, int pos) {
+  int* parent = game->power_parent;
+  int node = power_node(game, game->grid[pos]);
+  parent[node] = node;
+  game->power_size[node] = 1;
+  game->power_has_stone[node] = node >= game->max_turrets;
+
+  int x = to_x(game, pos);
+  int y = to_y(game, pos);
+  int adj[4][2] = {{x + 1, y}, {x, y + 1}, {x - 1, y}, {x, y - 1}};
+  for (int i = 0; i < 4; ++i) {
+    if (!is_in_grid(game, adj[i][0], adj[i][1]))
+      continue;
+
+    int adj_node = power_node(game, game->grid[to_pos(game, adj[i][0], adj[i][1])]);
+    if (adj_node == -1)
+      continue;
+
+    // hang the smaller tree off the bigger one
+    int a = find_root(parent, node);
+    int b = find_root(parent, adj_node);
+    if (a == b)
+      continue;
+    if (game->power_size[a] < game->power_size[b] || (game->power_size[a] == game->power_size[b] && b < a)) {
+      int tmp = a;
+      a = b;
+      b = tmp;
+    }
+    parent[b] = a;
+    game->power_size[a] += game->power_size[b];
+    game->power_has_stone[a] = game->power_has_stone[a] || game->power_has_stone[b];
+  }
+}
+
+// the turret/stone on the tile has just been removed from the grid, which may have split its network
+// rebuilds a tree for each piece by flooding out from each of the tile's neighbours,
+// so only the network it was part of is visited
+void split_power(Game* game, int pos) {
+  int* parent = game->power_parent;
+  int* queue = game->power_queue;
+  unsigned int gen = ++game->power_gen;
+
+  int x = to_x(game, pos);
+  int y = to_y(game, pos);
+  int adj[4][2] = {{x + 1, y}, {x, y + 1}, {x - 1, y}, {x, y - 1}};
+  for (int i = 0; i < 4; ++i) {
+    if (!is_in_grid(game, adj[i][0], adj[i][1]))
+      continue;
+
+    int root = power_node(game, game->grid[to_pos(game, adj[i][0], adj[i][1])]);
+    if (root == -1 || game->power_mark[root] == gen)
+      continue; // not a turret/stone, or it's in a piece that's been done already
+
+    int head = 0;
+    int tail = 0;
+    bool has_stone = false;
+    game->power_mark[root] = gen;
+    queue[tail++] = root;
+    while (head < tail) {
+      int node = queue[head++];
+      parent[node] = root;
+      has_stone = has_stone || node >= game->max_turrets;
+
+      int node_pos = power_node_pos(game, node);
+      int node_x = to_x(game, node_pos);
+      int node_y = to_y(game, node_pos);
+      int node_adj[4][2] = {{node_x + 1, node_y}, {node_x, node_y + 1}, {node_x - 1, node_y}, {node_x, node_y - 1}};
+      for (int j = 0; j < 4; ++j) {
+        if (!is_in_grid(game, node_adj[j][0], node_adj[j][1]))
+          continue;
+
+        int adj_node = power_node(game, game->grid[to_pos(game, node_adj[j][0], node_adj[j][1])]);
+        if (adj_node == -1 || game->power_mark[adj_node] == gen)
+          continue;
+
+        game->power_mark[adj_node] = gen;
+        queue[tail++] = adj_node;
+      }
+    }
+    game->power_size[root] = tail;
+    game->power_has_stone[root] = has_stone;
+  }
+}
+
+// picks a random free tile next to the entity (-1 if it's boxed in)
+int choose_adj_pos(Game* game, Ref ref, Rng* rng) {
+  Pool* pool = ref_pool(game, ref);
+  int x = pool->x[ref_slot(ref)];
+  int y = pool->y[ref_slot(ref)];
+  int free_pos[8];
+  int num_free = 0;
+  for (int dir_x = -1; dir_x <= 1; ++dir_x) {
+    for (int dir_y = -1; dir_y <= 1; ++dir_y) {
+      if (!dir_x && !dir_y)
+        continue; // 0,0 isn't a real move
+
+      int new_x = x + dir_x;
+      int new_y = y + dir_y;
+      if (is_in_grid(game, new_x, new_y) && !game->grid[to_pos(game, new_x, new_y)])
+        free_pos[num_free++] = to_pos(game, new_x, new_y);
+    }
+  }
+
+  if (!num_free)
+    return -1;
+  else
+    return free_pos[rng_int(rng, num_free)];
+}
+
+// breadth-first search out from every turret at once, through tiles that
+// aren't blocked, to find how many moves each tile is from the nearest turret
+// stops at beast_attack_dist, since beasts don't go after turrets beyond that
+void update_flow(Game* game) {
+  byte* flow_dist = game->flow_dist;
+  int* flow_queue = game->flow_queue;
+
+  // reset the tiles that the last search reached
+  for (int i = 0; i < game->flow_queue_len; ++i)
+    flow_dist[flow_queue[i]] = FLOW_UNREACHED;
+
+  int max_dist = clamp(beast_attack_dist, 0, FLOW_UNREACHED - 1);
+  int head = 0;
+  int tail = 0;
+  Pool* turrets = &game->pools[KIND_TURRET];
+  for (int i = 0; i < turrets->slots.num_live; ++i) {
+    int turret = turrets->slots.live[i];
+    int pos = to_pos(game, turrets->x[turret], turrets->y[turret]);
+    flow_dist[pos] = 0;
+    flow_queue[tail++] = pos;
+  }
+
+  while (head < tail) {
+    int pos = flow_queue[head++];
+    int dist = flow_dist[pos] + 1;
+    if (dist >= max_dist)
+      continue;
+
+    int x = to_x(game, pos);
+    int y = to_y(game, pos);
+    for (int dir_x = -1; dir_x <= 1; ++dir_x) {
+      for (int dir_y = -1; dir_y <= 1; ++dir_y) {
+        int new_x = x + dir_x;
+        int new_y = y + dir_y;
+        if (!is_in_grid(game, new_x, new_y))
+          continue;
+
+        int new_pos = to_pos(game, new_x, new_y);
+        if (flow_dist[new_pos] != FLOW_UNREACHED)
+          continue;
+        if (is_block_kind(ref_kind(game->grid[new_pos])))
+          continue;
+
+        flow_dist[new_pos] = dist;
+        flow_queue[tail++] = new_pos;
+      }
+    }
+  }
+
+  game->flow_queue_len = tail;
+  game->is_flow_dirty = false;
+}
+
+// the free adjacent tile that gets the beast closest to a turret
+// (-1 if there's no turret in range or the way is blocked by other beasts)
+int flow_step(Game* game, Ref beast) {
+  int x = game->pools[KIND_BEAST].x[ref_slot(beast)];
+  int y = game->pools[KIND_BEAST].y[ref_slot(beast)];
+  int best_pos = -1;
+  int best_dist = game->flow_dist[to_pos(game, x, y)];
+  for (int dir_x = -1; dir_x <= 1; ++dir_x) {
+    for (int dir_y = -1; dir_y <= 1; ++dir_y) {
+      int new_x = x + dir_x;
+      int new_y = y + dir_y;
+      if (!is_in_grid(game, new_x, new_y))
+        continue;
+
+      int new_pos = to_pos(game, new_x, new_y);
+      if (!game->grid[new_pos] && game->flow_dist[new_pos] < best_dist) {
+        best_pos = new_pos;
+        best_dist = game->flow_dist[new_pos];
+      }
+    }
+  }
+  return best_pos;
+}
+
+// the turret a beast would attack: the closest adjacent one, if any
+Ref adj_turret(Game* game, Ref beast) {
+  int x = game->pools[KIND_BEAST].x[ref_slot(beast)];
+  int y = game->pools[KIND_BEAST].y[ref_slot(beast)];
+  Ref winner = NO_REF;
+  int winner_dist_sq = 0;
+  for (int dir_x = -1; dir_x <= 1; ++dir_x) {
+    for (int dir_y = -1; dir_y <= 1; ++dir_y) {
+      int new_x = x + dir_x;
+      int new_y = y + dir_y;
+      if (!is_in_grid(game, new_x, new_y))
+        continue;
+
+      Ref ref = game->grid[to_pos(game, new_x, new_y)];
+      if (ref_kind(ref) != KIND_TURRET)
+        continue;
+
+      // orthogonal neighbours are closer than diagonal ones
+      int dist_sq = dir_x * dir_x + dir_y * dir_y;
+      if (!winner || dist_sq < winner_dist_sq || (dist_sq == winner_dist_sq && ref < winner)) {
+        winner = ref;
+        winner_dist_sq = dist_sq;
+      }
+    }
+  }
+  return winner;
+}
+
+void inflict_damage(Game* game, Ref ref) {
+  byte* health = &ref_pool(game, ref)->health[ref_slot(ref)];
+  (*health)--;
+  if (*health <= 0)
+    del_entity(game, ref);
+}
+
+
+// Generic Functions
+
+// runs fn over items 0 to len-1, split evenly across the worker threads & this one
+// returns once they're all done
+void parallel_for(Game* game, int len, RangeFn fn) {
+  Workers* w = &game->workers;
+  if (w->num == -1)
+    start_workers(game);
+  if (!w->num || len < 2) {
+    fn(game, 0, len);
+    return;
+  }
+
+  pthread_mutex_lock(&w->lock);
+  w->fn = fn;
+  w->len = len;
+  w->num_working = w->num;
+  w->gen++;
+  pthread_cond_broadcast(&w->ready);
+  pthread_mutex_unlock(&w->lock);
+
+  // this thread takes the first share
+  fn(game, 0, (int)((int64_t)len / (w->num + 1)));
+
+  pthread_mutex_lock(&w->lock);
+  while (w->num_working)
+    pthread_cond_wait(&w->done, &w->lock);
+  pthread_mutex_unlock(&w->lock);
+}
+
+void start_workers(Game* game) {
+  Workers* w = &game->workers;
+  w->num = game->num_shares - 1;
+  if (!w->num)
+    return;
+
+  pthread_mutex_init(&w->lock, NULL);
+  pthread_cond_init(&w->ready, NULL);
+  pthread_cond_init(&w->done, NULL);
+  w->gen = 0;
+  w->num_working = 0;
+  w->is_stopping = false;
+  w->workers = malloc(w->num * sizeof(Worker));
+  if (!w->workers)
+    sim_error("allocating worker threads");
+  for (int i = 0; i < w->num; ++i) {
+    w->workers[i].game = game;
+    w->workers[i].n = i + 1;
+    if (pthread_create(&w->workers[i].thread, NULL, run_worker, &w->workers[i]))
+      sim_error("starting worker thread");
+  }
+}
+
+// waits for the Game's workers to finish & frees them (they're started again if they're needed)
+void stop_workers(Game* game) {
+  Workers* w = &game->workers;
+  if (w->num > 0) {
+    pthread_mutex_lock(&w->lock);
+    w->is_stopping = true;
+    w->gen++;
+    pthread_cond_broadcast(&w->ready);
+    pthread_mutex_unlock(&w->lock);
+
+    for (int i = 0; i < w->num; ++i)
+      pthread_join(w->workers[i].thread, NULL);
+    free(w->workers);
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->ready);
+    pthread_cond_destroy(&w->done);
+  }
+  w->num = -1;
+}
+
+// worker n (from 1) does the nth share of each parallel_for() until the workers are stopped
+void* run_worker(void* arg) {
+  Worker* worker = arg;
+  Workers* w = &worker->game->workers;
+  unsigned int seen_gen = 0;
+  while (true) {
+    pthread_mutex_lock(&w->lock);
+    while (w->gen == seen_gen)
+      pthread_cond_wait(&w->ready, &w->lock);
+    seen_gen = w->gen;
+    bool is_stopping = w->is_stopping;
+    RangeFn fn = w->fn;
+    int len = w->len;
+    pthread_mutex_unlock(&w->lock);
+    if (is_stopping)
+      break;
+
+    int n = worker->n;
+    int num_shares = w->num + 1;
+    fn(worker->game, (int)((int64_t)len * n / num_shares), (int)((int64_t)len * (n + 1) / num_shares));
+
+    pthread_mutex_lock(&w->lock);
+    if (!--w->num_working)
+      pthread_cond_signal(&w->done);
+    pthread_mutex_unlock(&w->lock);
+  }
+  return NULL;
+}
+
+void arena_init(Arena* arena, size_t size) {
+  arena->base = malloc(size);
+  if (!arena->base)
+    sim_error("allocating arena");
+  arena->size = size;
+  arena->used = 0;
+}
+
+// allocations are 16-byte aligned
+void* arena_alloc(Arena* arena, size_t size) {
+  size_t start = (arena->used + 15) & ~(size_t)15;
+  if (start + size > arena->size)
+    sim_error("allocating from arena (it's too small)");
+
+  arena->used = start + size;
+  return arena->base ? arena->base + start : NULL;
+}
+
+// frees everything that's been allocated from the arena
+void arena_reset(Arena* arena) {
+  arena->used = 0;
+}
+
+void arena_free(Arena* arena) {
+  free(arena->base);
+  arena->base = NULL;
+  arena->size = 0;
+  arena->used = 0;
+}
+
+void alloc_slots(Slots* slots, int cap, Arena* arena) {
+  slots->live = arena_alloc(arena, cap * sizeof(int));
+  slots->link = arena_alloc(arena, cap * sizeof(int));
+  slots->cap = cap;
+}
+
+// frees every slot (they're handed out lowest first)
+void slots_reset(Slots* slots) {
+  for (int i = 0; i < slots->cap; ++i)
+    slots->link[i] = i + 1 < slots->cap ? i + 1 : -1;
+  slots->free_head = slots->cap ? 0 : -1;
+  slots->num_live = 0;
+}
+
+// returns the slot or -1 if they're all in use
+int slots_take(Slots* slots) {
+  int slot = slots->free_head;
+  if (slot == -1)
+    return -1;
+
+  slots->free_head = slots->link[slot];
+  slots->link[slot] = slots->num_live;
+  slots->live[slots->num_live++] = slot;
+  return slot;
+}
+
+// moves the last live slot into the freed one's place in the live list
+void slots_free(Slots* slots, int slot) {
+  int ix = slots->link[slot];
+  int last = slots->live[--slots->num_live];
+  slots->live[ix] = last;
+  slots->link[last] = ix;
+
+  slots->link[slot] = slots->free_head;
+  slots->free_head = slot;
+}
+
+// the splitmix64 finalizer: a cheap hash w/ good avalanche
+uint64_t mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+// a stream that's independent of every other (stream, id) for the same seed
+Rng rng_stream(uint64_t seed, int stream, int id) {
+  Rng rng = {.key = mix(mix(mix(seed) + stream) + id), .ctr = 0};
+  return rng;
+}
+
+// the numbers an entity draws on a given tick
+// leaves room for 256 draws per tick before it'd overlap w/ the next tick
+Rng entity_rng(Game* game, int stream, int id, unsigned int tick) {
+  Rng rng = rng_stream(game->seed, stream, id);
+  rng.ctr = (uint64_t)tick << 8;
+  return rng;
+}
+
+uint64_t rng_next(Rng* rng) {
+  return mix(rng->key + rng->ctr++ * 0x9E3779B97F4A7C15ULL);
+}
+
+// a number from 0 to n-1 (n has to be positive)
+int rng_int(Rng* rng, int n) {
+  return (int)(((rng_next(rng) >> 32) * (uint64_t)n) >> 32);
+}
+
+double calc_dist(int x1, int y1, int x2, int y2) {
+  return sqrt(pow(x1 - x2, 2) + pow(y1 - y2, 2));
+}
+
+int clamp(int val, int min, int max) {
+  if (val < min)
+    return min;
+  else if (val > max)
+    return max;
+  else
+    return val;
+}
+
+// grows the rect to include the tile at x,y
+void extend_rect(TileRect* r, int x, int y) {
+  if (x < r->x1)
+    r->x1 = x;
+  if (x > r->x2)
+    r->x2 = x;
+  if (y < r->y1)
+    r->y1 = y;
+  if (y > r->y2)
+    r->y2 = y;
+}
+
+void sim_error(char* activity) {
+  printf("%s failed\n", activity);
+  exit(-1);
+}
@@ -0,0 +1,431 @@
+// simulation core: map generation, building & the game update
+// has no SDL dependency, so it can run headless (see headless.c)
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+typedef unsigned char byte;
+
+// x86 builds also get SIMD versions of the hot loops, picked at runtime by what the CPU supports
+#if defined(__x86_64__) || defined(__i386__)
+#define HAS_X86_KERNELS
+#endif
+
+// entity flags (an entity's kind is given by which pool it's in)
+#define DELETED 0x1
+#define POWER 0x2 // power bullet (turrets get theirs from the power network, see is_powered())
+
+// entity kinds, each w/ its own pool
+// the first NUM_INDEXED_KINDS are tracked by the spatial index (see closest_entity())
+#define KIND_BEAST 0
+#define KIND_NEST 1
+#define KIND_TURRET 2
+#define KIND_BLOCK 3
+#define KIND_STONE 4 // power stone
+#define NUM_KINDS 5
+#define NUM_INDEXED_KINDS 3
+
+// the grid refers to entities by a kind + slot packed into an int (0 means no entity)
+// small maps can build w/ -DSMALL_GRID to halve the grid's size again
+#ifdef SMALL_GRID
+typedef uint16_t Ref;
+#define SLOT_BITS 13
+#else
+typedef uint32_t Ref;
+#define SLOT_BITS 28
+#endif
+#define SLOT_MASK ((1 << SLOT_BITS) - 1)
+#define NO_REF 0
+
+#define FLOW_UNREACHED 255 // flow_dist of tiles too far from any turret
+
+// road_masks bits, for which of a road's neighbours are roads too
+#define ROAD_ABOVE 0x1
+#define ROAD_BELOW 0x2
+#define ROAD_LEFT 0x4
+#define ROAD_RIGHT 0x8
+
+// coast_codes have one of these for each quarter of a tile, 2 bits apiece
+#define COAST_WATER 0 // open water (nothing to draw)
+#define COAST_LAND 1 // a square quarter of land
+#define COAST_OUTER 2 // a land corner rounded off b/c there's water on both sides of it
+#define COAST_INNER 3 // a water corner rounded in b/c there's land on both sides of it & diagonally
+
+// random number streams, one per subsystem so that e.g. adding a draw to
+// beast movement doesn't change the terrain that a given seed generates
+#define RNG_TERRAIN 1
+#define RNG_PLACEMENT 2
+#define RNG_BEASTS 3
+#define RNG_NESTS 4
+
+// what the player can build (see place_entity())
+#define BUILD_ROAD 0
+#define BUILD_FORTRESS 1
+#define BUILD_BRIDGE 2
+
+// a fixed number of slots that can be taken & freed in O(1),
+// w/ a dense list of the ones in use so loops don't have to skip free ones
+typedef struct {
+  int* live; // [cap] the slots in use, in no particular order
+  int* link; // [cap] for a free slot, the next free one (-1 ends the list); for a slot in use, where it is in live
+  int num_live;
+  int free_head; // -1 when they're all in use
+  int cap;
+} Slots;
+
+// the entities of one kind, stored as a column per field
+typedef struct {
+  Slots slots;
+  uint16_t* x;
+  uint16_t* y;
+  byte* flags;
+  byte* health;
+} Pool;
+
+// inclusive range of tiles, e.g. the ones visible in the viewport
+typedef struct {
+  int x1;
+  int y1;
+  int x2;
+  int y2;
+} TileRect;
+
+// counter-based generator: the nth number of a stream is a hash of (key, n),
+// so any number can be drawn w/o stepping through the ones before it
+typedef struct {
+  uint64_t key;
+  uint64_t ctr;
+} Rng;
+
+// bullets are packed into the first num slots (deleting one moves the last into its place)
+// & stored as float columns, so move_bullets() can advance 8 at a time w/ SIMD
+typedef struct {
+  float* x; // in px
+  float* y;
+  float* prev_x; // where it was before the last step, for render interpolation
+  float* prev_y;
+  float* dx; // unit vector
+  float* dy;
+  byte* flags; // POWER
+  byte* is_out; // [(max_bullets + 7) / 8] bitmask of the ones the last step took off the map
+  int num;
+  float max_x; // the map's size in px (they're out once they're past it)
+  float max_y;
+} Bullets;
+
+// advances every bullet by step px & fills in is_out (see pick_bullet_kernel())
+typedef void (*BulletKernel)(Bullets* bullets, float step);
+
+// what a beast will do this move, worked out in parallel w/ the others (see move_beasts())
+typedef struct {
+  Ref beast;
+  Ref turret; // the adjacent turret it attacks (NO_REF if none)
+  int dest_pos; // where it moves to afterwards (-1 if it blows up instead)
+} BeastMove;
+
+// what a turret fires at this time, worked out in parallel w/ the others (see fire_turrets())
+typedef struct {
+  Ref target; // NO_REF if there's nothing in range
+  double dx; // unit vector towards the target
+  double dy;
+} TurretShot;
+
+typedef struct Game Game;
+
+// does part of a data-parallel phase: items start to end-1
+typedef void (*RangeFn)(Game* game, int start, int end);
+
+// one phase of a step (see step_phases)
+// they all take dt so they fit in the table (the ones that don't need it ignore it)
+typedef struct {
+  char* name;
+  void (*fn)(Game* game, double dt);
+} Phase;
+
+// called after each of a step's phases w/ its index in step_phases (bench uses it to time them)
+typedef void (*PhaseHook)(Game* game, int phase);
+
+// a worker thread, which does the nth share of each parallel_for() (n from 1)
+typedef struct {
+  pthread_t thread;
+  Game* game;
+  int n;
+} Worker;
+
+// a Game's worker threads, which sleep until parallel_for() bumps gen
+// (they're started by the first parallel_for() & have to be stopped w/ stop_workers())
+typedef struct {
+  Worker* workers;
+  int num; // -1 until they're started
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+  pthread_cond_t done;
+  unsigned int gen;
+  int num_working;
+  bool is_stopping;
+  RangeFn fn;
+  int len;
+} Workers;
+
+// a block of memory that allocations are carved out of in order
+// & that is freed all at once by resetting it
+typedef struct {
+  byte* base; // NULL to just measure how much would be allocated
+  size_t size;
+  size_t used;
+} Arena;
+
+// everything that changes while a level is played
+// the arrays come from alloc_level(), sized per calc_level_sizes()
+// (a Game mustn't be moved once its workers have started)
+struct Game {
+  // the level's sizes, set by calc_level_sizes() from the settings
+  // (the map size & caps are copied, so the settings can change w/o affecting this level)
+  int num_blocks_w;
+  int num_blocks_h;
+  int grid_len;
+  int mask_w; // 64-bit words per row of a bit plane
+  int num_buckets_w;
+  int num_buckets_h;
+  int num_chunks_w;
+  int num_chunks_h;
+  int max_beasts;
+  int max_turrets;
+  int max_bullets;
+  int max_blocks;
+  int max_power_stones;
+  int max_nests;
+  int num_water_levels; // levels above the 1-tile squares in the water quadtree (see gen_water())
+  int num_shares; // how many parts parallel_for() splits work into: the worker threads + the caller
+
+  Ref* grid; // [grid_len]
+
+  // terrain bit planes, a bit per tile in rows of mask_w words (see get_bit())
+  uint64_t* water; // [num_blocks_h * mask_w]
+  uint64_t* roads; // [num_blocks_h * mask_w] roads & bridges
+  uint64_t* explored; // [num_blocks_h * mask_w]
+  uint64_t* plane_scratch; // [num_blocks_h * mask_w]
+  short* water_vals; // [num_shares * (num_water_levels + 1) * num_blocks_w] gen_water_bands()'s scratch, a slice per share
+  byte* coast_codes; // [grid_len] a COAST_* for each quarter (top-left, top-right, bottom-left, bottom-right from the low bits)
+  byte* road_masks; // [grid_len] ROAD_* bits, kept up to date for road tiles by connect_road()
+
+  Pool pools[NUM_KINDS]; // [kind_cap(kind)] each
+  Bullets bullets; // [max_bullets] each
+  BeastMove* beast_moves; // [max_beasts] one per live beast, in live-list order
+  TurretShot* turret_shots; // [max_turrets] one per live turret, in live-list order
+
+  uint64_t seed; // set by the caller before load()
+  Rng terrain_rng;
+  Rng place_rng;
+
+  // set by load() to the fastest kernel the CPU supports (it can be swapped for another after)
+  BulletKernel advance_bullets;
+  char* bullet_kernel_name;
+  Workers workers;
+
+  int num_collected_blocks;
+  int start_pos; // where the starting fortress was built
+
+  // sim clock & the last time each periodic phase ran, in ms
+  double time;
+  double last_move_time;
+  double last_fire_time;
+  double last_mine_time;
+  double last_spawn_time;
+  unsigned int num_moves; // how many times the beasts have moved
+  unsigned int num_spawns; // how many times the nests have spawned
+
+  // spatial index: NUM_INDEXED_KINDS live entity counts per bucket
+  int* bucket_counts; // [num_buckets_w * num_buckets_h * NUM_INDEXED_KINDS]
+
+  // beast navigation: the number of moves from each tile to the nearest turret,
+  // found by a breadth-first search out from all turrets at once
+  // it's only recomputed when a turret or block is added/removed
+  byte* flow_dist; // [grid_len]
+  int* flow_queue; // [grid_len] the search queue, which ends up listing every tile it reached
+  int flow_queue_len;
+  bool is_flow_dirty;
+
+  // the islands the map was generated w/ (bridges don't join them)
+  int* island_ids; // [grid_len] which island each tile is on (-1 for water)
+  int* island_sizes; // [(grid_len + 1) / 2] how many tiles each island has
+  int num_islands;
+
+  // power network: turrets & stones that touch (not diagonally) are connected,
+  // & all of them are powered if any is a stone
+  // it's a union-find forest over power nodes: the turret slots, then the stone slots
+  // joined as they're placed & split up again (just the affected part) when one is removed
+  int* power_parent; // [max_turrets + max_power_stones]
+  int* power_size; // [max_turrets + max_power_stones] how many nodes a root's tree has
+  bool* power_has_stone; // [max_turrets + max_power_stones] for roots, whether their tree has a stone
+  int* power_queue; // [max_turrets + max_power_stones] scratch for split_power()
+  unsigned int* power_mark; // [max_turrets + max_power_stones] power_gen when split_power() last reached it
+  unsigned int power_gen;
+
+  int* explored_stencil; // [explored_dist * 2 + 1] half-width of each row of the explored_dist disk
+
+  // what has changed since the renderer's caches were last updated
+  // (the sim itself never reads these)
+  bool* dirty_chunks; // [num_chunks_w * num_chunks_h]
+  TileRect explored_dirty;
+};
+
+// settings
+extern int block_ratio;
+extern int num_blocks_per_road;
+extern int num_blocks_per_turret;
+extern int num_blocks_per_refurb;
+extern int num_blocks_per_bridge;
+extern int beast_attack_dist;
+extern int fortress_attack_dist;
+extern byte beast_health;
+extern byte fortress_health;
+extern byte nest_health;
+extern int explored_dist;
+
+extern int block_w;
+extern int block_h;
+extern double bullet_speed;
+extern double tick_dt;
+extern int block_density_pct;
+
+extern int num_blocks_w;
+extern int num_blocks_h;
+
+extern int beast_move_interval;
+extern int turret_fire_interval;
+extern int mine_interval;
+extern int beast_spawn_interval;
+
+extern int max_beasts;
+extern int num_starting_beasts;
+extern int max_turrets;
+extern int max_bullets;
+extern int max_power_stones;
+extern int max_nests;
+
+extern int bucket_size;
+
+extern int chunk_size;
+
+extern TileRect empty_rect;
+
+extern int num_threads;
+
+#define NUM_STEP_PHASES 5
+extern Phase step_phases[NUM_STEP_PHASES];
+
+// grid functions
+int find_avail_pos(Game* game);
+void move(Game* game, Ref ref, int x, int y);
+void set_pos(Game* game, Ref ref, int pos);
+void set_xy(Game* game, Ref ref, int x, int y);
+void remove_from_grid(Game* game, Ref ref);
+int to_x(Game* game, int ix);
+int to_y(Game* game, int ix);
+int to_pos(Game* game, int x, int y);
+bool is_in_grid(Game* game, int x, int y);
+int to_bucket(Game* game, int x, int y);
+
+// entity functions
+Ref new_entity(Game* game, int kind);
+int kind_cap(Game* game, int kind);
+Ref to_ref(int kind, int slot);
+int ref_kind(Ref ref);
+int ref_slot(Ref ref);
+Pool* ref_pool(Game* game, Ref ref);
+bool is_block_kind(int kind);
+bool is_enemy_kind(int kind);
+
+// game-specific functions
+void calc_level_sizes(Game* game);
+size_t calc_level_bytes(Game* game);
+void alloc_level(Game* game, Arena* arena);
+void load(Game* game);
+void step(Game* game, double dt);
+void step_with_hook(Game* game, double dt, PhaseHook on_phase);
+void mine_blocks(Game* game, double dt);
+void fire_turrets(Game* game, double dt);
+void aim_turrets(Game* game, int start, int end);
+void spawn_beasts(Game* game, double dt);
+void move_beasts(Game* game, double dt);
+void plan_beast_moves(Game* game, int start, int end);
+void move_bullets(Game* game, double dt);
+BulletKernel pick_bullet_kernel(char** name);
+void advance_bullets_scalar(Bullets* bullets, float step);
+void advance_bullet_range(Bullets* bullets, int start, float step);
+#ifdef HAS_X86_KERNELS
+void advance_bullets_avx(Bullets* bullets, float step);
+void advance_bullets_sse2(Bullets* bullets, float step);
+#endif
+void gen_water(Game* game);
+void gen_water_bands(Game* game, int start, int end);
+void gen_water_rows(Game* game, short vals[], int start, int end);
+void remove_sm_islands(Game* game, int start, int end);
+void remove_sm_lakes(Game* game, int start, int end);
+bool get_bit(Game* game, uint64_t plane[], int x, int y);
+void set_bit(Game* game, uint64_t plane[], int x, int y);
+uint64_t span_bits(int i, int x1, int x2);
+uint64_t mask_word(Game* game, uint64_t mask[], int i, int y, bool is_land);
+uint64_t adj_bits(Game* game, uint64_t mask[], int i, int y, bool is_land);
+uint64_t shifted_word(Game* game, uint64_t mask[], int i, int y, int dx, bool is_land);
+void calc_coast_codes(Game* game, int start, int end);
+void place_entity(Game* game, int x, int y, int build);
+int update_explored(Game* game, int pos);
+void connect_road(Game* game, int x, int y);
+void calc_explored_stencil(int stencil[]);
+
+bool is_next_to_wall(Game* game, Ref beast);
+bool is_adj(Game* game, int x, int y);
+bool is_adj_left(Game* game, int x, int y, bool road_only);
+bool is_adj_right(Game* game, int x, int y, bool road_only);
+bool is_adj_above(Game* game, int x, int y, bool road_only);
+bool is_adj_below(Game* game, int x, int y, bool road_only);
+void beast_explode(Game* game, Ref beast);
+Ref closest_entity(Game* game, int x, int y, int kind, int max_dist);
+Ref trace_bullet(Game* game, double x1, double y1, double x2, double y2);
+void del_bullet(Game* game, int i);
+void del_entity(Game* game, Ref ref);
+void mark_dirty(Game* game, int x, int y);
+int power_node(Game* game, Ref ref);
+int power_node_pos(Game* game, int node);
+bool is_powered(Game* game, Ref ref);
+void join_power(Game* game, int pos);
+void split_power(Game* game, int pos);
+int choose_adj_pos(Game* game, Ref ref, Rng* rng);
+void update_flow(Game* game);
+int flow_step(Game* game, Ref beast);
+Ref adj_turret(Game* game, Ref beast);
+void inflict_damage(Game* game, Ref ref);
+int label_islands(Game* game, int parent[]);
+void join_trees(int parent[], int a, int b);
+int find_root(int parent[], int i);
+
+// generic functions
+void parallel_for(Game* game, int len, RangeFn fn);
+void start_workers(Game* game);
+void stop_workers(Game* game);
+void* run_worker(void* arg);
+void arena_init(Arena* arena, size_t size);
+void* arena_alloc(Arena* arena, size_t size);
+void arena_reset(Arena* arena);
+void arena_free(Arena* arena);
+void alloc_slots(Slots* slots, int cap, Arena* arena);
+void slots_reset(Slots* slots);
+int slots_take(Slots* slots);
+void slots_free(Slots* slots, int slot);
+uint64_t mix(uint64_t x);
+Rng rng_stream(uint64_t seed, int stream, int id);
+Rng entity_rng(Game* game, int stream, int id, unsigned int tick);
+uint64_t rng_next(Rng* rng);
+int rng_int(Rng* rng, int n);
+double calc_dist(int x1, int y1, int x2, int y2);
+int clamp(int val, int min, int max);
+void extend_rect(TileRect* r, int x, int y);
+void sim_error(char* activity);
+
+#endif